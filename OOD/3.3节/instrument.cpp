@@ -0,0 +1,134 @@
+#include <iostream>
+#include <cstring>
+
+#include "instrument.h"
+
+const char* counter_names[counter_num] = {
+    "are_you_compares", "find_all_iterations", "attach_calls", "detach_calls", "copy_attaches"
+};
+const char* timer_names[timer_num] = { "find_item", "find_all", "list_copy" };
+
+#ifdef OOD_INSTRUMENT
+
+thread_local InstrumentBlock* instrument_local = NULL;
+
+///< 所有线程的计数区组成的链表, 只会增长
+static std::atomic<InstrumentBlock*> instrument_head(NULL);
+
+/* 新的计数区用 compare_exchange 头插到链表上, 已经挂上的计数区不会再被修改链接,
+   所以遍历链表的线程不需要加锁 */
+InstrumentBlock* instrument_register()
+{
+    InstrumentBlock* b = new InstrumentBlock;
+    int i;
+
+    for (i = 0; i < counter_num; ++i) {
+        b->counts[i].store(0, std::memory_order_relaxed);
+    }
+    for (i = 0; i < timer_num; ++i) {
+        b->timer_calls[i].store(0, std::memory_order_relaxed);
+        b->timer_ns[i].store(0, std::memory_order_relaxed);
+    }
+    b->next = instrument_head.load(std::memory_order_relaxed);
+    while (!instrument_head.compare_exchange_weak(b->next, b, std::memory_order_release,
+        std::memory_order_relaxed)) {
+    }
+    return b;
+}
+
+int instrument_enabled()
+{
+    return 1;
+}
+
+void instrument_snapshot(InstrumentTotals& t)
+{
+    InstrumentBlock* b;
+    int i;
+
+    memset(&t, 0, sizeof(t));
+    for (b = instrument_head.load(std::memory_order_acquire); b != NULL; b = b->next) {
+        for (i = 0; i < counter_num; ++i) {
+            t.counts[i] += b->counts[i].load(std::memory_order_relaxed);
+        }
+        for (i = 0; i < timer_num; ++i) {
+            t.timer_calls[i] += b->timer_calls[i].load(std::memory_order_relaxed);
+            t.timer_ns[i] += b->timer_ns[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void instrument_reset()
+{
+    InstrumentBlock* b;
+    int i;
+
+    for (b = instrument_head.load(std::memory_order_acquire); b != NULL; b = b->next) {
+        for (i = 0; i < counter_num; ++i) {
+            b->counts[i].store(0, std::memory_order_relaxed);
+        }
+        for (i = 0; i < timer_num; ++i) {
+            b->timer_calls[i].store(0, std::memory_order_relaxed);
+            b->timer_ns[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+#else
+
+int instrument_enabled()
+{
+    return 0;
+}
+
+void instrument_snapshot(InstrumentTotals& t)
+{
+    memset(&t, 0, sizeof(t));
+}
+
+void instrument_reset()
+{
+}
+
+#endif
+
+void instrument_dump(std::ostream& out)
+{
+    InstrumentTotals t;
+    int i;
+
+    instrument_snapshot(t);
+    for (i = 0; i < counter_num; ++i) {
+        out << counter_names[i] << ": " << t.counts[i] << "\n";
+    }
+    for (i = 0; i < timer_num; ++i) {
+        out << timer_names[i] << ": " << t.timer_calls[i] << " calls, " << t.timer_ns[i] / 1000.0 << " us";
+        if (t.timer_calls[i]) {
+            out << ", " << (double)t.timer_ns[i] / t.timer_calls[i] << " ns/call";
+        }
+        out << "\n";
+    }
+}
+
+void instrument_export(std::ostream& out)
+{
+    InstrumentTotals t;
+
+    instrument_snapshot(t);
+    instrument_export(out, t);
+}
+
+void instrument_export(std::ostream& out, const InstrumentTotals& t)
+{
+    int i;
+
+    out << "{ \"enabled\": " << (instrument_enabled() ? "true" : "false");
+    for (i = 0; i < counter_num; ++i) {
+        out << ", \"" << counter_names[i] << "\": " << t.counts[i];
+    }
+    for (i = 0; i < timer_num; ++i) {
+        out << ", \"" << timer_names[i] << "\": { \"calls\": " << t.timer_calls[i];
+        out << ", \"ns\": " << t.timer_ns[i] << " }";
+    }
+    out << " }";
+}
@@ -0,0 +1,120 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <iostream>
+
+/* 选课模型热路径上的计数器和计时器. 编译时定义 OOD_INSTRUMENT 才会启用,
+   否则下面的宏都展开为空, 热路径上没有任何额外的代码.
+   启用时需要支持 C++11 thread_local 的编译器(Visual Studio 2015 及以上, 或 GCC/Clang -std=c++11).
+
+   每个线程第一次记录时分配一块自己的计数区, 用无锁的头插法挂到全局链表上,
+   之后只有这个线程写它, 写入是 relaxed 的读-加-写, 没有锁, 也没有原子的读改写指令.
+   导出时遍历链表把各线程的计数加起来, 可以在任何线程中进行.
+   计数区在线程退出后仍然保留, 所以已经结束的线程的计数不会丢失 */
+
+///< 计数器
+enum InstrumentCounter {
+    are_you_compares,       ///< find_item 中调用 are_you 的次数
+    find_all_iterations,    ///< find_all 内层循环的次数
+    attach_calls,           ///< attach_object 的调用次数
+    detach_calls,           ///< detach_object 的调用次数
+    copy_attaches,          ///< 列表拷贝构造函数引起的 attach_object 次数
+    counter_num
+};
+
+///< 计时器, 每个计时器记录调用次数和总耗时
+enum InstrumentTimer {
+    find_item_timer,
+    find_all_timer,
+    list_copy_timer,
+    timer_num
+};
+
+///< 各线程计数之和
+struct InstrumentTotals {
+    unsigned long long counts[counter_num];
+    unsigned long long timer_calls[timer_num];
+    unsigned long long timer_ns[timer_num];
+};
+
+///< 是否编译进了计数代码
+int instrument_enabled();
+///< 汇总所有线程的计数
+void instrument_snapshot(InstrumentTotals&);
+/* 把所有线程的计数清零. 计数区只由所属线程写入, 清零时不能有其他线程正在记录 */
+void instrument_reset();
+///< 以文本形式输出汇总结果
+void instrument_dump(std::ostream&);
+///< 以 JSON 对象的形式输出汇总结果, 第二种形式输出事先取得的快照
+void instrument_export(std::ostream&);
+void instrument_export(std::ostream&, const InstrumentTotals&);
+
+#ifdef OOD_INSTRUMENT
+
+#include <atomic>
+#include <chrono>
+
+struct InstrumentBlock {
+    std::atomic<unsigned long long> counts[counter_num];
+    std::atomic<unsigned long long> timer_calls[timer_num];
+    std::atomic<unsigned long long> timer_ns[timer_num];
+    InstrumentBlock* next;
+};
+
+extern thread_local InstrumentBlock* instrument_local;
+InstrumentBlock* instrument_register();
+
+///< 只有本线程写自己的计数区, 不需要 fetch_add
+inline void instrument_bump(std::atomic<unsigned long long>& slot, unsigned long long n)
+{
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline InstrumentBlock* instrument_block()
+{
+    if (instrument_local == NULL) {
+        instrument_local = instrument_register();
+    }
+    return instrument_local;
+}
+
+inline void instrument_count(int counter, unsigned long long n)
+{
+    instrument_bump(instrument_block()->counts[counter], n);
+}
+
+///< 作用域计时器: 构造时开始计时, 析构时把耗时记到指定的计时器上
+class ScopedTimer {
+    int timer;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScopedTimer(int);
+    ~ScopedTimer();
+};
+
+inline ScopedTimer::ScopedTimer(int t)
+{
+    timer = t;
+    start = std::chrono::steady_clock::now();
+}
+
+inline ScopedTimer::~ScopedTimer()
+{
+    InstrumentBlock* b = instrument_block();
+    instrument_bump(b->timer_calls[timer], 1);
+    instrument_bump(b->timer_ns[timer], (unsigned long long)std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+#define OOD_COUNT(counter, n) instrument_count(counter, n)
+#define OOD_TIME(timer) ScopedTimer ood_scoped_timer(timer)
+
+#else
+
+#define OOD_COUNT(counter, n) ((void)0)
+#define OOD_TIME(timer) ((void)0)
+
+#endif
+
+#endif
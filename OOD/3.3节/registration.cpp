@@ -0,0 +1,476 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdarg>
+
+#include "registration.h"
+#include "instrument.h"
+
+int registration_verbose = 1;
+
+/* 科目的构造函数要求以下参数: 名字, 描述, 课时长度, 先修科目的可变长度列表 */
+Course::Course(char* n, char* d, int len, int pnum, ...)
+{
+    int i;
+    ///< 可变参数宏
+    va_list ap;
+
+    strncpy(name, n, name_len);
+    strncpy(description, d, desc_len);
+
+    duration = len;
+    prereq = new CourseList(course_len);
+    reference_count = 1;
+
+    if (pnum) {
+        va_start(ap, pnum);
+        for (i = 0; i < pnum; ++i) {
+            prereq->add_item(*va_arg(ap, Course*));
+        }
+        va_end(ap);
+    }
+}
+
+/* 科目的拷贝构造函数拷贝所有的字符串, 并调用科目列表的拷贝构造函数*/
+Course::Course(const Course& rhs) 
+{
+    strcpy(name, rhs.name);
+    strcpy(description, rhs.description);
+    duration = rhs.duration;
+    prereq = new CourseList(*rhs.prereq);
+    reference_count = rhs.reference_count;
+}
+
+/*科目的析构函数删除了它的所有先修科目, 
+  并检查以确保调用 delete 删除科目对象的是科目最后一个使用者.*/
+Course::~Course() 
+{
+    delete prereq;
+    if (reference_count > 1) {
+        std::cout << "Error> A course object destroyed with ";
+        std::cout << reference_count << " other objects referencing it. \n";
+    }
+}
+
+/* 每个应用科目对象的对象都必须调用 attach_objcet 来向该对象注册自身*/
+int Course::attach_object()
+{
+    OOD_COUNT(attach_calls, 1);
+    return (++reference_count);
+}
+
+/* 每个调用过 attach_objcet 的对象都必须在析构函数中调用 detach_objcet 来减少引用计数*/
+int Course::detach_object()
+{
+    OOD_COUNT(detach_calls, 1);
+    return (--reference_count);
+}
+
+/* 为了给科目增加一门选修科目, 我们调用科目列表的 add_item 方法,
+   这个方法若无法增加这门科目(列表已满), 那么返回0*/
+void Course::add_prereq(Course& new_prereq) 
+{
+    if (prereq->add_item(new_prereq) == 0) {
+        std::cout << "Error: Cannot add any new prepequisites.\n";
+    }
+}
+
+void Course::print()
+{
+    using std::cout;
+    cout << "\n\nCourse: " << name << "\n";
+    cout << "Description: " << description << "\n";
+    cout << "Duration: " << duration << "\n";
+    cout << "List of Prerequisites: ";
+    prereq->print();
+    cout << "\n\n";
+}
+
+/* short_print 方法用在我们指向看到科目的名字而不想看到科目的关联信息的场合*/
+void Course::short_print()
+{
+    std::cout << name;
+}
+
+/* 科目对象收到一个科目列表, 并调用 CourseList::find_all 方法来检查先修科目. 
+   这个方法检查是否参数列表中的所有科目都在消息所发送至的列表中*/
+int Course::check_prereq(CourseList& courses_taken)
+{
+    return (courses_taken.find_all(*prereq));
+}
+
+/* 这个方法检查它的名字是否等于传递进来的名字,
+   这是用来根据名字从一个科目列表中找到一门特定的科目*/
+int Course::are_you(char* guess_name) 
+{
+    return (!strcmp(name, guess_name));
+}
+
+CourseList::CourseList(int sz)
+{
+    course_num = 0;
+    courses = new Course*[size = sz];
+}
+
+/*每个科目只是被引用, 而不是被复制*/
+CourseList::CourseList(CourseList& rhs)
+{
+    int i;
+    OOD_TIME(list_copy_timer);
+    courses = new Course*[size=rhs.size];
+    for (i = 0; i < rhs.course_num; ++i) {
+        courses[i] = rhs.courses[i];
+        courses[i]->attach_object();
+    }
+    OOD_COUNT(copy_attaches, rhs.course_num);
+    course_num = rhs.course_num;
+}
+
+/* 科目列表的析构函数释放先修科目列表中的每个对象, 如果哪次调用 detach_object 方法使得引用计数为0,
+   那么这个科目列表就是使用该科目的最后一个对象, 应当调用科目的析构函数*/
+CourseList::~CourseList()
+{
+    int i;
+    for (i = 0; i < course_num; ++i) {
+        if (courses[i]->detach_object() == 1) {
+            delete courses[i];
+        }
+    }
+    delete [] courses;
+}
+
+/* add_item 方法检查以确保列表还有空间*/
+int CourseList::add_item(Course& new_item)
+{
+    if (course_num == size) {
+        return 0;
+    } else {
+        courses[course_num++] = &new_item;
+        new_item.attach_object();
+    }
+
+    return 1;
+}
+
+/* 在课程列表中找出匹配用户传递的名称的课程, 如果没有找到, 那么该方法返回空指针*/
+Course* CourseList::find_item(char* guess_name)
+{
+    int i;
+    OOD_TIME(find_item_timer);
+    for (i = 0; i < course_num; ++i) {
+        if (courses[i]->are_you(guess_name)) {
+            OOD_COUNT(are_you_compares, i + 1);
+            return courses[i];
+        }
+    }
+    OOD_COUNT(are_you_compares, course_num);
+    return NULL;
+}
+
+/* 该方法检查待查找列表中的所有科目对象是否都存在于消息所发送至的列表中, 
+   因为这些列表中的科目都是前拷贝, 我们只需要检查科目对象的地址, 而不需要比较科目名称 */
+int CourseList::find_all(CourseList& findlist)
+{
+    int i, j, found;
+
+    OOD_TIME(find_all_timer);
+    for (i = 0; i < findlist.course_num; ++i) {
+        found = 0;
+        for (j = 0; j < course_num && !found; ++j) {
+            if (findlist.courses[i] == courses[j]) {
+                found = 1;
+            }
+        }
+        OOD_COUNT(find_all_iterations, j);
+        if (!found) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void CourseList::print()
+{
+    int i;
+    std::cout << "\n\n";
+
+    for (i = 0; i < course_num; ++i) {
+        courses[i]->short_print();
+        std::cout << " ";
+    }
+    std::cout << "\n\n";
+}
+
+
+Student::Student(char* n, char* s, int a, int num, ...)
+{
+    int i;
+    va_list ap;
+
+    strncpy(name, n, name_len);
+    strncpy(ssn, s, small_strlen);
+    age = a;
+    courses = new CourseList(course_len);
+    reference_count = 1;
+    if (num) {
+        va_start(ap, num);
+        for (i = 0; i < num; ++i) {
+            courses->add_item(*va_arg(ap, Course*));
+        }
+        va_end(ap);
+    }
+}
+
+Student::Student(const Student& rhs)
+{
+    strcpy(name, rhs.name);
+    strcpy(ssn, rhs.ssn);
+    age = rhs.age;
+    courses = new CourseList(*rhs.courses);
+    reference_count = rhs.reference_count;
+}
+
+Student::~Student()
+{
+    delete courses;
+}
+
+int Student::attach_object()
+{
+    OOD_COUNT(attach_calls, 1);
+    return (++reference_count);
+}
+
+int Student::detach_object()
+{
+    OOD_COUNT(detach_calls, 1);
+    return (--reference_count);
+}
+
+void Student::add_course(Course& c)
+{
+    if (courses->add_item(c) == 0) {
+        std::cout << "Cannot add any new courses to the Sutdent.\n";
+    }
+}
+
+/* 我们需要一个访问方法 */
+CourseList& Student::get_courses()
+{
+    return *courses;
+}
+
+void Student::print()
+{
+    using std::cout;
+    cout << "\n\nName: " << name << "\n";
+    cout << "SSN: " << ssn << "\n";
+    cout << "Age " << age << "\n";
+    cout << "Prerequisites: ";
+    courses->print();
+    cout << "\n\n";
+}
+
+void Student::short_print()
+{
+    std::cout << name;
+}
+
+int Student::are_you(char* guess_name)
+{
+    return (!strcmp(name, guess_name));
+}
+
+StudentList::StudentList(int sz)
+{
+    student_num = 0;
+    students = new Student*[size=sz];
+}
+
+StudentList::StudentList(StudentList& rhs)
+{
+    int i;
+    OOD_TIME(list_copy_timer);
+    students = new Student*[size=rhs.size];
+    for (i = 0; i < rhs.student_num; ++i) {
+        students[i] = rhs.students[i];
+        students[i]->attach_object();
+    }
+    OOD_COUNT(copy_attaches, rhs.student_num);
+    student_num = rhs.student_num;
+}
+
+StudentList::~StudentList()
+{
+    int i;
+    for (i = 0; i < student_num; ++i) {
+        if (students[i]->detach_object() == 1) {
+            delete students[i];
+        }
+    }
+    delete [] students;
+}
+
+int StudentList::add_item(Student& new_item)
+{
+    if (student_num == size) {
+        return 0;
+    } else {
+        students[student_num++] = &new_item;
+        new_item.attach_object();
+    }
+    return 1;
+}
+
+Student* StudentList::find_item(char* guess_name) 
+{
+    int i;
+    OOD_TIME(find_item_timer);
+    for (i = 0; i < student_num; ++i) {
+        if (students[i]->are_you(guess_name)) {
+            OOD_COUNT(are_you_compares, i + 1);
+            return students[i];
+        }
+    }
+    OOD_COUNT(are_you_compares, student_num);
+    return NULL;
+}
+
+void StudentList::print()
+{
+    int i;
+    for (i = 0; i < student_num; ++i) {
+        students[i]->short_print();
+        std::cout << " ";
+    }
+}
+
+
+CourseOffering::CourseOffering(Course& c, char* r, char* d)
+{
+    course = &c;
+    course->attach_object();
+    strncpy(room, r, small_strlen);
+    strncpy(date, d, small_strlen);
+    attendees = new StudentList(student_len);
+}
+
+CourseOffering::CourseOffering(const CourseOffering& rhs)
+{
+    course = rhs.course;
+    course->attach_object();
+    strcpy(room, rhs.room);
+    strcpy(date, rhs.date);
+    attendees = new StudentList(*rhs.attendees);
+}
+
+CourseOffering::~CourseOffering()
+{
+    if (course->detach_object() == 1) {
+        delete course;
+    }
+    delete attendees;
+}
+
+/* 课程确保选课的新生已经修过必要的先修课程, 这是通过获取该学生已经修过的科目清单并将之
+   传递给 check_prereq 方法来实现的, 课程可以检查学生是否已经修过所有要求的先修科目, 
+   因为课程已经有了先修科目列表, 并通过调用学生的 get_courses 方法来获得了科目列表*/
+void CourseOffering::add_student(Student& new_student)
+{
+    if (course->check_prereq(new_student.get_courses())) {
+        attendees->add_item(new_student);
+        if (registration_verbose) {
+            std::cout << "Student added to course.\n";
+        }
+    } else if (registration_verbose) {
+        std::cout << "Admission refused: Student does not hava the ";
+        std::cout << "necessary prerequisites\n";
+    }
+}
+
+void CourseOffering::print()
+{
+    using std::cout;
+
+    cout << "\n\nThe course offering for ";
+    course->short_print();
+    cout << " will be held in room " << room << " starting on ";
+    cout << date << "\n";
+    cout << "Current attendees include: ";
+    attendees->print();
+    cout << "\n\n";
+}
+
+void CourseOffering::short_print()
+{
+    course->short_print();
+    std::cout << " (" << date << ") ";
+}
+
+/* 在比较课程时, 比较科目名还不够, 还需要比较日期 */
+int CourseOffering::are_you(char* guess_name, char* guess_date)
+{
+    return (!strcmp(guess_date, date) && course->are_you(guess_name));
+}
+
+
+OfferingList::OfferingList(int sz)
+{
+    offering_num = 0;
+    offerings = new CourseOffering*[size=sz];
+}
+
+OfferingList::OfferingList(OfferingList& rhs)
+{
+    int i;
+
+    OOD_TIME(list_copy_timer);
+    offerings = new CourseOffering*[size=rhs.size];
+    for (i = 0; i < rhs.offering_num; ++i) {
+        offerings[i] = rhs.offerings[i];
+    }
+    offering_num = rhs.offering_num;
+}
+
+OfferingList::~OfferingList()
+{
+    int i;
+    for (i = 0; i < offering_num; ++i) {
+        delete offerings[i];
+    }
+    delete [] offerings;
+}
+
+int OfferingList::add_item(CourseOffering& new_item)
+{
+    if (offering_num == size) {
+        return 0;
+    } else {
+        offerings[offering_num++] = &new_item;
+    }
+    return 1;
+}
+
+CourseOffering* OfferingList::find_item(char* guess_name, char* date)
+{
+    int i;
+    OOD_TIME(find_item_timer);
+    for (i = 0; i < offering_num; ++i) {
+        if (offerings[i]->are_you(guess_name, date)) {
+            OOD_COUNT(are_you_compares, i + 1);
+            return offerings[i];
+        }
+    }
+    OOD_COUNT(are_you_compares, offering_num);
+    return NULL;
+}
+
+void OfferingList::print()
+{
+    int i;
+    for (i = 0; i < offering_num; ++i) {
+        offerings[i]->short_print();
+        std::cout << " ";
+    }
+}
+
@@ -0,0 +1,135 @@
+#ifndef REGISTRATION_H
+#define REGISTRATION_H
+
+///< 列表类的预先引用
+class CourseList;
+class StudentList;
+class OfferingList;
+
+///< 程序中用到的常量
+const int name_len = 30;
+const int desc_len = 128;
+const int course_len = 30;
+const int student_len = 50;
+const int small_strlen = 15;
+
+///< 选课结果是否打印到屏幕上, 无人值守的负载测试中关闭
+extern int registration_verbose;
+
+/* 科目有 名字, 描述, 课时长度, 先修科目*/
+class Course {
+private:
+    char name[name_len];
+    char description[desc_len];
+    int duration;
+    CourseList* prereq;
+    int reference_count;
+
+public:
+    Course(char*, char*, int, int, ...);
+    Course(const Course&);
+    ~Course();
+
+    ///< 增加计数器值
+    int attach_object();
+    /* 减少计数器值, 如果其返回值为0, 那么调用者就知道 
+       它是这个科目对象的最后一个调用者, 调用科目对象的析构函数 */
+    int detach_object();
+    void add_prereq(Course&);
+    int check_prereq(CourseList&);
+    void print();
+    void short_print();
+    int are_you(char*);
+};
+
+/* 每个关键抽象都有一个对应的列表类来维护列表操作 */
+class CourseList {
+private:
+    Course **courses;
+    int size;
+    int course_num;
+
+public:
+    CourseList(int);
+    CourseList(CourseList&);
+    ~CourseList();
+    int add_item(Course&);
+    Course* find_item(char*);
+    int find_all(CourseList&);
+    void print();
+};
+
+/* 学生有姓名, 社保号码, 年龄, 类似于科目对象, 学生也有一个科目清单, 引用计数的工作方式同科目类一模一样 */
+class Student {
+private:
+    char name[name_len];
+    char ssn[small_strlen];
+    int age;
+    CourseList* courses;
+    int reference_count;
+
+public:
+    Student(char*, char*, int, int, ...);
+    Student(const Student&);
+    ~Student();
+    int attach_object();
+    int detach_object();
+    void add_course(Course&);
+    CourseList& get_courses();
+    void print();
+    void short_print();
+    int are_you(char*);
+};
+
+/* 学生列表同科目列表一样, 唯一不同之处是他用来处理学生对象, 而不是科目对象 */
+class StudentList {
+private:
+    Student **students;
+    int size;
+    int student_num;
+
+public:
+    StudentList(int);
+    StudentList(StudentList&);
+    ~StudentList();
+    int add_item(Student&);
+    Student* find_item(char*);
+    void print();
+};
+
+/* 课程类表示了这样的关系, 某个科目, 在某个教室中, 在某个特定的日期被讲授, 同一组特定的
+   学生的关系, 这不是一个应用计数类, 因为我们从来不在多个列表中共享课程对象*/
+class CourseOffering {
+private:
+    Course* course;
+    char room[small_strlen];
+    char date[small_strlen];
+    StudentList* attendees;
+
+public:
+    CourseOffering(Course&, char*, char*);
+    CourseOffering(const CourseOffering&);
+    ~CourseOffering();
+    void add_student(Student&);
+    void print();
+    void short_print();
+    int are_you(char*, char*);
+};
+
+/* 课程列表类类似于学生列表和科目列表类 */
+class OfferingList {
+private:
+    CourseOffering **offerings;
+    int size;
+    int offering_num;
+
+public:
+    OfferingList(int);
+    OfferingList(OfferingList&);
+    ~OfferingList();
+    int add_item(CourseOffering&);
+    CourseOffering* find_item(char*, char*);
+    void print();
+};
+
+#endif
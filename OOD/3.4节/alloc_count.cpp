@@ -0,0 +1,23 @@
+#include <cstdlib>
+#include <new>
+
+#include "alloc_count.h"
+
+std::atomic<unsigned long> alloc_count(0);
+
+void* operator new(std::size_t sz)
+{
+    void* p;
+
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    p = std::malloc(sz ? sz : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    std::free(p);
+}
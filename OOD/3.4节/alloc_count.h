@@ -0,0 +1,10 @@
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+#include <atomic>
+
+/* 分配计数: alloc_count.cpp 替换了全局的 operator new, 每次分配都在这里加 1.
+   基准测试用它来确认控制循环中没有发生堆分配. 一个程序只能链接一份 alloc_count.cpp */
+extern std::atomic<unsigned long> alloc_count;
+
+#endif
@@ -0,0 +1,770 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "heating.h"
+
+///< 是否把房间和炉子的状态打印到屏幕上, 无人值守的基准测试中关闭
+int verbose = 1;
+
+/* 每个设备各自保存随机数状态(构造时用 rand() 取种子), 而不是每次读数都调用 rand(),
+   这样多个线程同时读各自的传感器时不会争用 rand() 内部的全局状态 */
+int next_random(unsigned int& seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return (int)((seed >> 16) & 0x7FFF);
+}
+
+DesiredTempActuator::DesiredTempActuator()
+{
+    seed = rand();
+}
+
+int DesiredTempActuator::get_temp()
+{
+    return (next_random(seed) % 40) + 50;
+}
+
+ActualTempSensor::ActualTempSensor()
+{
+    seed = rand();
+}
+
+int ActualTempSensor::get_temp()
+{
+    return (next_random(seed) % 40) + 50;
+}
+
+OccupancySensor::OccupancySensor()
+{
+    seed = rand();
+}
+
+int OccupancySensor::anyone_in_room()
+{
+    return (next_random(seed) % 2);
+}
+
+Room::Room(char* n)
+{
+    strncpy(name, n, name_len);
+    sensor_id = 0;
+    vacant_level = vacant_threshold;
+    occupied_level = occupied_threshold;
+    last_work_temp = 0;
+    last_occupied = 0;
+}
+
+/* 从建筑描述文件载入的房间带有传感器编号, 以及无人/有人时各自的供暖阈值 */
+Room::Room(char* n, int sensor, int vacant, int occupied)
+{
+    strncpy(name, n, name_len);
+    name[name_len - 1] = '\0';
+    sensor_id = sensor;
+    vacant_level = vacant;
+    occupied_level = occupied;
+    last_work_temp = 0;
+    last_occupied = 0;
+}
+
+///< 房间对象通过计算工作(期待温度-实际温度) 并检查房内是否有人来判断是否需要供暖
+
+int Room::do_you_need_heat()
+{
+    int work_temp, occupied;
+
+    work_temp = dtemp.get_temp() - atemp.get_temp();
+    occupied = occ.anyone_in_room();
+    last_work_temp = work_temp;
+    last_occupied = occupied;
+
+    if (verbose) {
+        std::cout << " The " << name << " has a working temp of " << work_temp;
+        std::cout << " and " << (occupied ? "someone in the room.\n" : "no one in the rom.\n");
+    }
+
+    if (work_temp > vacant_level && !occupied || work_temp > occupied_level && occupied) {
+        return 1;
+    }
+    return 0;
+}
+
+int Room::get_sensor_id()
+{
+    return sensor_id;
+}
+
+int Room::get_work_temp()
+{
+    return last_work_temp;
+}
+
+int Room::is_occupied()
+{
+    return last_occupied;
+}
+
+void Furnace::provide_heat()
+{
+    if (verbose) {
+        std::cout << "Furnamce Running \n";
+    }
+}
+
+void Furnace::turnoff()
+{
+    if (verbose) {
+        std::cout << "Furnace Turned Off \n";
+    }
+}
+
+FurnaceController::FurnaceController(Furnace* f, int on_cycles, int off_cycles, int on_lv, int off_lv)
+{
+    heater = f;
+    state = furnace_unknown;
+    dwell = 0;
+    min_on = on_cycles;
+    min_off = off_cycles;
+    on_level = on_lv;
+    off_level = off_lv;
+    requests = 0;
+    actuations = 0;
+    held = 0;
+}
+
+int band_on_level(int room_num)
+{
+    if (room_num < 1) {
+        return 1;
+    }
+    return room_num < default_on_level ? room_num : default_on_level;
+}
+
+/* 每个周期调用一次, demand 是需要供暖的房间数, 返回炉子当前是否在运行.
+   滞回带决定"想要"的状态, 最短保持时间决定现在能不能切换, 两者都满足才真正驱动炉子 */
+int FurnaceController::update(int demand)
+{
+    int want;
+
+    ++requests;
+    ///< dwell 只需要与最短保持时间比较, 到达两者中较大的那个就不再增长, 长时间运行也不会溢出
+    if (dwell < min_on || dwell < min_off) {
+        ++dwell;
+    }
+    if (state == furnace_unknown) {
+        want = (demand >= on_level);
+    } else if (state) {
+        want = (demand > off_level);
+    } else {
+        want = (demand >= on_level);
+    }
+
+    if (want == state) {
+        return state;
+    }
+    if ((state == 1 && dwell < min_on) || (state == 0 && dwell < min_off)) {
+        ++held;
+        return state;
+    }
+
+    if (want) {
+        heater->provide_heat();
+    } else {
+        heater->turnoff();
+    }
+    state = want;
+    dwell = 0;
+    ++actuations;
+
+    return state;
+}
+
+int FurnaceController::is_running()
+{
+    return (state == 1);
+}
+
+unsigned long FurnaceController::get_requests()
+{
+    return requests;
+}
+
+unsigned long FurnaceController::get_actuations()
+{
+    return actuations;
+}
+
+unsigned long FurnaceController::get_held()
+{
+    return held;
+}
+
+void FurnaceController::print_stats()
+{
+    print_actuation_stats(requests, actuations, held);
+}
+
+/* 原来的调节器每个周期都会驱动一次炉子, 因此 requests 就是原来的命令数 */
+void print_actuation_stats(unsigned long requests, unsigned long actuations, unsigned long held)
+{
+    using std::cout;
+    cout << "Furnace cycles: " << requests << ", actuations: " << actuations;
+    cout << ", suppressed: " << requests - actuations;
+    cout << " (" << held << " held by dwell time)";
+    if (requests) {
+        cout << ", reduction " << 100.0 * (requests - actuations) / requests << "%";
+    }
+    cout << "\n";
+}
+
+/* 容量向上取整到 2 的幂, 这样取槽位只需要一次按位与 */
+TelemetryRing::TelemetryRing(unsigned long sz)
+{
+    capacity = 2;
+    while (capacity < sz) {
+        capacity <<= 1;
+    }
+    mask = capacity - 1;
+    records = new TelemetryRecord[capacity];
+    head.store(0, std::memory_order_relaxed);
+}
+
+TelemetryRing::~TelemetryRing()
+{
+    delete [] records;
+}
+
+/* 只有控制循环一个写者, 因此读取 head 用 relaxed 即可, 写完槽位后再以 release 发布 */
+void TelemetryRing::record(unsigned int cycle, unsigned short room, int work_temp, unsigned char flags)
+{
+    unsigned long long h = head.load(std::memory_order_relaxed);
+    TelemetryRecord& r = records[h & mask];
+
+    r.cycle = cycle;
+    r.room = room;
+    r.work_temp = (signed char)work_temp;
+    r.flags = flags;
+    head.store(h + 1, std::memory_order_release);
+}
+
+unsigned long long TelemetryRing::written() const
+{
+    return head.load(std::memory_order_acquire);
+}
+
+/* 返回序号从 since 开始到当前为止的所有记录, 已被覆盖的部分自动跳过.
+   最多返回 capacity - 1 条, 给写者正在写的那个槽位留出余地 */
+TelemetryView TelemetryRing::snapshot(unsigned long long since) const
+{
+    TelemetryView v;
+    unsigned long long h = head.load(std::memory_order_acquire);
+    unsigned long num, start;
+
+    if (h - since >= capacity) {
+        since = h - (capacity - 1);
+    }
+    if (since > h) {
+        since = h;
+    }
+    num = (unsigned long)(h - since);
+    start = (unsigned long)(since & mask);
+
+    v.begin = since;
+    v.first = records + start;
+    if (start + num <= capacity) {
+        v.first_num = num;
+        v.second = records;
+        v.second_num = 0;
+    } else {
+        v.first_num = capacity - start;
+        v.second = records;
+        v.second_num = num - v.first_num;
+    }
+    return v;
+}
+
+/* 读者读完视图后调用, 返回 0 表示读的过程中写者已经追上并覆盖了视图中的记录 */
+int TelemetryRing::still_valid(const TelemetryView& v) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (head.load(std::memory_order_relaxed) - v.begin < capacity);
+}
+
+/* 紧凑二进制转储: 8 字节魔数和记录数, 之后是按时间顺序排列的原始记录.
+   直接从缓冲区写出, 不做逐条转换; 返回写出的记录数, 转储期间被覆盖则返回 0 */
+unsigned long TelemetryRing::dump(std::ostream& out) const
+{
+    TelemetryView v = snapshot(0);
+    unsigned int num = (unsigned int)(v.first_num + v.second_num);
+
+    out.write("HFTELEM1", 8);
+    out.write((const char*)&num, sizeof(num));
+    out.write((const char*)v.first, v.first_num * sizeof(TelemetryRecord));
+    out.write((const char*)v.second, v.second_num * sizeof(TelemetryRecord));
+    if (!still_valid(v)) {
+        return 0;
+    }
+    return num;
+}
+
+HeatFlowRegulator::HeatFlowRegulator(FurnaceController* f, int num, Room** rooms) 
+{
+    int i;
+
+    heater = f;
+    room_num = num < 0 ? 0 : num;
+    cycle = 0;
+    telemetry = NULL;
+    house = new Room*[room_num];
+    for (i = 0; i < room_num; ++i) {
+        house[i] = rooms[i];
+    }
+}
+
+///< 调节器只拥有指针数组, 房间本身仍由创建者负责
+HeatFlowRegulator::~HeatFlowRegulator()
+{
+    delete [] house;
+}
+
+/* 遥测是可选的, 调节器只是关联一个环形缓冲区, 并不拥有它.
+   房间序号放不进记录的 16 位 room 字段时(或会与 furnace_room 混淆)拒绝关联, 返回 0 */
+int HeatFlowRegulator::attach_telemetry(TelemetryRing* t)
+{
+    if (room_num >= furnace_room) {
+        std::cout << "Error: telemetry supports at most " << furnace_room - 1;
+        std::cout << " rooms per furnace, " << room_num << " given.\n";
+        return 0;
+    }
+    telemetry = t;
+    return 1;
+}
+
+FurnaceController* HeatFlowRegulator::get_controller()
+{
+    return heater;
+}
+
+/* 热流调节器的这个循环是为了检查每个房间是否需要供暖, 为了做到这一点,
+   调节器仅仅简单的查询房间是否需要供暖, 而真正的判断交给房间类 */
+int HeatFlowRegulator::loop()
+{
+    int any_need_heat = 0, need, running, i;
+
+    for (i = 0; i < room_num; ++i) {
+        need = house[i]->do_you_need_heat();
+        any_need_heat += need;
+        if (telemetry) {
+            telemetry->record(cycle, (unsigned short)i, house[i]->get_work_temp(),
+                (house[i]->is_occupied() ? tele_occupied : 0) | (need ? tele_demand : 0));
+        }
+    }
+    running = heater->update(any_need_heat);
+    if (telemetry) {
+        telemetry->record(cycle, furnace_room, 0, running ? tele_furnace_on : 0);
+    }
+    ++cycle;
+
+    return any_need_heat;
+}
+
+RegulationScheduler::RegulationScheduler(HeatFlowRegulator** regs, int num, int threads_wanted, long period_us)
+{
+    int i;
+
+    regulators = regs;
+    regulator_num = num;
+    thread_num = threads_wanted;
+    if (thread_num > regulator_num) {
+        thread_num = regulator_num;
+    }
+    if (thread_num < 1) {
+        thread_num = 1;
+    }
+    ranges = new WorkRange[thread_num];
+    for (i = 0; i < thread_num; ++i) {
+        ranges[i].begin = (int)((long long)regulator_num * i / thread_num);
+        ranges[i].end = (int)((long long)regulator_num * (i + 1) / thread_num);
+        ranges[i].next.store(ranges[i].end);
+    }
+    pending.store(0);
+    generation = 0;
+    stopping = 0;
+    period = std::chrono::microseconds(period_us);
+    deadline = std::chrono::steady_clock::now();
+
+    threads = new std::thread[thread_num];
+    for (i = 1; i < thread_num; ++i) {
+        threads[i] = std::thread(&RegulationScheduler::worker_main, this, i);
+    }
+}
+
+RegulationScheduler::~RegulationScheduler()
+{
+    int i;
+
+    {
+        std::lock_guard<std::mutex> guard(wake_lock);
+        stopping = 1;
+    }
+    wake.notify_all();
+    for (i = 1; i < thread_num; ++i) {
+        threads[i].join();
+    }
+    delete [] threads;
+    delete [] ranges;
+}
+
+int RegulationScheduler::get_thread_num()
+{
+    return thread_num;
+}
+
+/* 工作线程只在周期开始时被唤醒一次, 锁只保护唤醒条件, 执行调节任务时不持有任何锁 */
+void RegulationScheduler::worker_main(int id)
+{
+    unsigned int seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(wake_lock);
+            while (!stopping && generation == seen) {
+                wake.wait(guard);
+            }
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        execute(id);
+    }
+}
+
+/* 先做自己的那一段, 再依次从其他线程的段里偷. fetch_add 可能越过 end, 越过即表示该段已取完 */
+void RegulationScheduler::execute(int id)
+{
+    int i, task, done = 0;
+
+    for (i = 0; i < thread_num; ++i) {
+        WorkRange& r = ranges[(id + i) % thread_num];
+        while ((task = r.next.fetch_add(1)) < r.end) {
+            regulators[task]->loop();
+            ++done;
+        }
+    }
+    if (done) {
+        pending.fetch_sub(done);
+    }
+}
+
+/* 执行一个控制周期, 所有炉子都调节完毕后才返回. 先设置 pending 再重置各段,
+   这样上一周期迟到的线程即使偷到了本周期的任务, 计数也不会出错 */
+void RegulationScheduler::run_cycle()
+{
+    int i;
+
+    pending.store(regulator_num);
+    for (i = 0; i < thread_num; ++i) {
+        ranges[i].next.store(ranges[i].begin);
+    }
+    if (thread_num > 1) {
+        {
+            std::lock_guard<std::mutex> guard(wake_lock);
+            ++generation;
+        }
+        wake.notify_all();
+    }
+    execute(0);
+    while (pending.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+/* 按控制周期定时: 睡到下一个周期的起点, 起点按绝对时间推进, 不会因为每次的执行时间而漂移.
+   如果已经落后了一个以上的周期, 就从现在重新开始计时 */
+void RegulationScheduler::wait_next_period()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    deadline += period;
+    if (deadline < now) {
+        deadline = now;
+        return;
+    }
+    std::this_thread::sleep_until(deadline);
+}
+
+Building::Building()
+{
+    furnaces = NULL;
+    controls = NULL;
+    regulators = NULL;
+    order = NULL;
+    furnace_num = 0;
+    loaded = 0;
+    last_zone_id = -1;
+}
+
+Building::~Building()
+{
+    int i;
+    for (i = 0; i < furnace_num; ++i) {
+        delete regulators[i];
+        delete controls[i];
+    }
+    delete [] regulators;
+    delete [] controls;
+    delete [] furnaces;
+    delete [] order;
+}
+
+/* 解析一行声明, 出错时打印行号并返回 0. 房间通常按区域成组出现, 所以缓存上一次查到的区域,
+   这样大多数房间行不需要查表 */
+int Building::parse_line(char* line, int line_no)
+{
+    static const char* seps = " \t\r\n";
+    char *kind, *name, *ref, *arg;
+    std::map<std::string, int>::iterator it;
+    int args[4], i;
+
+    kind = strtok(line, seps);
+    if (kind == NULL || kind[0] == '#') {
+        return 1;
+    }
+    name = strtok(NULL, seps);
+    if (name == NULL) {
+        std::cout << "Error: line " << line_no << ": missing name.\n";
+        return 0;
+    }
+
+    if (!strcmp(kind, "furnace")) {
+        FurnaceSpec spec = { min_on_cycles, min_off_cycles, 0, default_off_level };
+        for (i = 0; i < 4 && (arg = strtok(NULL, seps)) != NULL; ++i) {
+            args[i] = atoi(arg);
+        }
+        if (i > 0) spec.min_on = args[0];
+        if (i > 1) spec.min_off = args[1];
+        if (i > 2) spec.on_level = args[2];
+        if (i > 3) spec.off_level = args[3];
+        if (spec.min_on < 0 || spec.min_off < 0) {
+            std::cout << "Error: line " << line_no << ": negative dwell time.\n";
+            return 0;
+        }
+        if (i > 2 && (spec.off_level < 0 || spec.off_level >= spec.on_level)) {
+            std::cout << "Error: line " << line_no << ": levels must satisfy 0 <= off < on.\n";
+            return 0;
+        }
+        if (!furnace_ids.insert(std::make_pair(std::string(name), (int)specs.size())).second) {
+            std::cout << "Error: line " << line_no << ": duplicate furnace " << name << ".\n";
+            return 0;
+        }
+        specs.push_back(spec);
+        return 1;
+    }
+
+    ref = strtok(NULL, seps);
+    if (ref == NULL) {
+        std::cout << "Error: line " << line_no << ": missing reference.\n";
+        return 0;
+    }
+
+    if (!strcmp(kind, "zone")) {
+        it = furnace_ids.find(ref);
+        if (it == furnace_ids.end()) {
+            std::cout << "Error: line " << line_no << ": unknown furnace " << ref << ".\n";
+            return 0;
+        }
+        if (!zone_ids.insert(std::make_pair(std::string(name), (int)zone_furnace.size())).second) {
+            std::cout << "Error: line " << line_no << ": duplicate zone " << name << ".\n";
+            return 0;
+        }
+        zone_furnace.push_back(it->second);
+        return 1;
+    }
+
+    if (!strcmp(kind, "room")) {
+        if (last_zone_id < 0 || last_zone != ref) {
+            it = zone_ids.find(ref);
+            if (it == zone_ids.end()) {
+                std::cout << "Error: line " << line_no << ": unknown zone " << ref << ".\n";
+                return 0;
+            }
+            last_zone = ref;
+            last_zone_id = it->second;
+        }
+        args[0] = 0;
+        args[1] = vacant_threshold;
+        args[2] = occupied_threshold;
+        for (i = 0; i < 3 && (arg = strtok(NULL, seps)) != NULL; ++i) {
+            args[i] = atoi(arg);
+        }
+        rooms.push_back(Room(name, args[0], args[1], args[2]));
+        room_furnace.push_back(zone_furnace[last_zone_id]);
+        return 1;
+    }
+
+    std::cout << "Error: line " << line_no << ": unknown declaration " << kind << ".\n";
+    return 0;
+}
+
+/* 所有房间都已连续存放在 rooms 中, 这里用一次计数排序把房间按炉子分组,
+   然后为每个炉子建立控制器和调节器 */
+void Building::wire()
+{
+    std::vector<int> first(specs.size() + 1, 0);
+    int i, f, on;
+
+    furnace_num = (int)specs.size();
+    order = new Room*[rooms.size() ? rooms.size() : 1];
+    for (i = 0; i < (int)rooms.size(); ++i) {
+        ++first[room_furnace[i] + 1];
+    }
+    for (f = 0; f < furnace_num; ++f) {
+        first[f + 1] += first[f];
+    }
+    std::vector<int> next(first.begin(), first.end() - 1);
+    for (i = 0; i < (int)rooms.size(); ++i) {
+        order[next[room_furnace[i]]++] = &rooms[i];
+    }
+
+    furnaces = new Furnace[furnace_num];
+    controls = new FurnaceController*[furnace_num];
+    regulators = new HeatFlowRegulator*[furnace_num];
+    for (f = 0; f < furnace_num; ++f) {
+        on = specs[f].on_level ? specs[f].on_level : band_on_level(first[f + 1] - first[f]);
+        controls[f] = new FurnaceController(furnaces + f, specs[f].min_on, specs[f].min_off,
+            on, specs[f].off_level);
+        regulators[f] = new HeatFlowRegulator(controls[f], first[f + 1] - first[f], order + first[f]);
+    }
+}
+
+/* 载入失败时丢弃已经解析的声明, 对象回到刚构造时的状态 */
+void Building::clear()
+{
+    rooms.clear();
+    room_furnace.clear();
+    specs.clear();
+    zone_furnace.clear();
+    furnace_ids.clear();
+    zone_ids.clear();
+    last_zone.clear();
+    last_zone_id = -1;
+}
+
+/* 一遍读完整个文件, 成功返回 1. 一个 Building 对象只能成功载入一次, 失败后可以再次载入.
+   超过 line_len - 1 个字符的行当作错误, 不会被截成两条声明 */
+int Building::load(const char* path)
+{
+    char line[line_len];
+    int line_no = 0, ok = 1;
+    std::FILE* in;
+
+    if (loaded) {
+        std::cout << "Error: building already loaded.\n";
+        return 0;
+    }
+    in = std::fopen(path, "r");
+    if (in == NULL) {
+        std::cout << "Error: cannot open " << path << ".\n";
+        return 0;
+    }
+    while (ok && std::fgets(line, line_len, in) != NULL) {
+        ++line_no;
+        if (strchr(line, '\n') == NULL && !std::feof(in)) {
+            std::cout << "Error: line " << line_no << ": longer than " << line_len - 1 << " characters.\n";
+            ok = 0;
+        } else {
+            ok = parse_line(line, line_no);
+        }
+    }
+    std::fclose(in);
+    if (!ok) {
+        clear();
+        return 0;
+    }
+
+    wire();
+    loaded = 1;
+    return 1;
+}
+
+int Building::get_room_num()
+{
+    return (int)rooms.size();
+}
+
+int Building::get_zone_num()
+{
+    return (int)zone_furnace.size();
+}
+
+int Building::get_furnace_num()
+{
+    return furnace_num;
+}
+
+HeatFlowRegulator** Building::get_regulators()
+{
+    return regulators;
+}
+
+/* 炉子数不超过房间数, 两者至少为 1 */
+SyntheticPlant::SyntheticPlant(int rooms_wanted, int furnaces_wanted)
+{
+    char name[name_len];
+    int i, first, num;
+
+    room_num = rooms_wanted < 1 ? 1 : rooms_wanted;
+    furnace_num = furnaces_wanted < 1 ? 1 : furnaces_wanted;
+    if (furnace_num > room_num) {
+        furnace_num = room_num;
+    }
+
+    rooms = new Room*[room_num];
+    for (i = 0; i < room_num; ++i) {
+        sprintf(name, "room%d", i);
+        rooms[i] = new Room(name);
+    }
+    furnaces = new Furnace[furnace_num];
+    controls = new FurnaceController*[furnace_num];
+    regulators = new HeatFlowRegulator*[furnace_num];
+    for (i = 0; i < furnace_num; ++i) {
+        first = (int)((long long)room_num * i / furnace_num);
+        num = (int)((long long)room_num * (i + 1) / furnace_num) - first;
+        controls[i] = new FurnaceController(furnaces + i, min_on_cycles, min_off_cycles,
+            band_on_level(num), default_off_level);
+        regulators[i] = new HeatFlowRegulator(controls[i], num, rooms + first);
+    }
+}
+
+SyntheticPlant::~SyntheticPlant()
+{
+    int i;
+    for (i = 0; i < furnace_num; ++i) {
+        delete regulators[i];
+        delete controls[i];
+    }
+    delete [] regulators;
+    delete [] controls;
+    delete [] furnaces;
+    for (i = 0; i < room_num; ++i) {
+        delete rooms[i];
+    }
+    delete [] rooms;
+}
+
+int SyntheticPlant::get_room_num()
+{
+    return room_num;
+}
+
+int SyntheticPlant::get_furnace_num()
+{
+    return furnace_num;
+}
+
+HeatFlowRegulator** SyntheticPlant::get_regulators()
+{
+    return regulators;
+}
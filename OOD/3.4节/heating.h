@@ -0,0 +1,300 @@
+#ifndef HEATING_H
+#define HEATING_H
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <map>
+#include <string>
+
+///< 例子中用到的常量
+const int name_len = 50;
+const int large_strlen = 128;
+const int room_len = 20;
+const int line_len = 512;
+const int vacant_threshold = 5;
+const int occupied_threshold = 0;
+const unsigned long telemetry_len = 1 << 16;
+const int min_on_cycles = 3;
+const int min_off_cycles = 3;
+const int default_on_level = 2;
+const int default_off_level = 0;
+
+///< 是否把房间和炉子的状态打印到屏幕上, 无人值守的基准测试中关闭
+extern int verbose;
+
+///< 输入期望温度的设备
+class DesiredTempActuator {
+    unsigned int seed;
+
+public:
+    DesiredTempActuator();
+    int get_temp();
+};
+
+///< 实际温度探测器
+class ActualTempSensor {
+    unsigned int seed;
+
+public:
+    ActualTempSensor();
+    int get_temp();
+};
+
+///< 探测房内是否有人
+class OccupancySensor {
+    unsigned int seed;
+
+public:
+    OccupancySensor();
+    int anyone_in_room();
+};
+
+///< 房间内包含上述三种设备, 并且有一个名字属性, 用来存放描述信息
+class Room {
+    char name[name_len];
+    DesiredTempActuator dtemp;
+    ActualTempSensor atemp;
+    OccupancySensor occ;
+    int sensor_id;
+    int vacant_level;
+    int occupied_level;
+    int last_work_temp;
+    int last_occupied;
+
+public:
+    Room(char*);
+    Room(char*, int, int, int);
+    int do_you_need_heat();
+    int get_sensor_id();
+    ///< 最近一次 do_you_need_heat 采样到的工作温度和占用情况, 供遥测记录使用
+    int get_work_temp();
+    int is_occupied();
+};
+
+/* 供暖炉子不值得特别关注 */
+class Furnace {
+public:
+    void provide_heat();
+    void turnoff();
+};
+
+/* 炉子控制器跟踪炉子的实际状态, 只在状态真正改变时才向炉子发出命令.
+   传感器有噪声, 需要供暖的房间数可能每个周期都在跳动, 所以这里加了两层过滤:
+   滞回带(需要供暖的房间数 >= on_level 才点火, <= off_level 才熄火),
+   以及最短运行/停机周期数(状态改变后至少保持这么多个周期).
+   调用者保证 0 <= off_level < on_level, 默认是 default_on_level / default_off_level */
+class FurnaceController {
+    Furnace* heater;
+    int state;
+    int dwell;
+    int min_on;
+    int min_off;
+    int on_level;
+    int off_level;
+    unsigned long requests;
+    unsigned long actuations;
+    unsigned long held;
+
+public:
+    FurnaceController(Furnace*, int, int, int, int);
+    int update(int);
+    int is_running();
+    unsigned long get_requests();
+    unsigned long get_actuations();
+    unsigned long get_held();
+    void print_stats();
+};
+
+/* 输出炉子命令的统计: 请求数, 真正发出的命令数, 被过滤掉的数目. 多个炉子时传入各炉子之和 */
+void print_actuation_stats(unsigned long requests, unsigned long actuations, unsigned long held);
+
+/* 默认滞回带的点火房间数. 房间数少于 default_on_level 的调节器用房间总数,
+   否则炉子永远不会点火 */
+int band_on_level(int room_num);
+
+///< 炉子的初始状态未知, 第一次 update 一定会发出命令
+const int furnace_unknown = -1;
+
+/* 遥测记录定长 8 字节: 每个周期每个房间一条, 周期末尾再追加一条炉子记录(room 为 furnace_room).
+   房间序号只有 16 位, 所以一个调节器最多 furnace_room 个房间才能挂遥测.
+   工作温度的取值范围是 -39 ~ 39, 用 signed char 足够 */
+struct TelemetryRecord {
+    unsigned int cycle;
+    unsigned short room;
+    signed char work_temp;
+    unsigned char flags;
+};
+
+const unsigned short furnace_room = 0xFFFF;
+const unsigned char tele_occupied = 0x01;
+const unsigned char tele_demand = 0x02;
+const unsigned char tele_furnace_on = 0x04;
+
+/* 零拷贝读视图: 环形缓冲区回绕时, 数据分成两段, 两段都直接指向缓冲区内部.
+   begin 是第一条记录的序号, 读完之后需要调用 TelemetryRing::still_valid 确认期间没有被覆盖 */
+struct TelemetryView {
+    const TelemetryRecord* first;
+    unsigned long first_num;
+    const TelemetryRecord* second;
+    unsigned long second_num;
+    unsigned long long begin;
+};
+
+/* 遥测环形缓冲区: 构造时一次分配, 之后控制循环中只写内存, 不分配, 不做 I/O.
+   单写者多读者, 写者每写一条记录就以 release 语义发布写入序号, 读者不加锁,
+   旧记录被新记录覆盖, 所以内存占用固定为 容量 * 8 字节 */
+class TelemetryRing {
+    TelemetryRecord* records;
+    unsigned long capacity;
+    unsigned long mask;
+    std::atomic<unsigned long long> head;
+
+    TelemetryRing(const TelemetryRing&);
+    TelemetryRing& operator=(const TelemetryRing&);
+
+public:
+    TelemetryRing(unsigned long);
+    ~TelemetryRing();
+    void record(unsigned int, unsigned short, int, unsigned char);
+    unsigned long long written() const;
+    TelemetryView snapshot(unsigned long long) const;
+    int still_valid(const TelemetryView&) const;
+    unsigned long dump(std::ostream&) const;
+};
+
+/* 热流调节器并不包含房间的列表, 也不包含供暖的炉子. 塔筒他们是关联关系
+   调节器通过炉子控制器间接驱动炉子, 以免每个周期都重复发送同样的命令.
+   房间指针数组按实际房间数分配, 不再受 room_len 的限制, 房间数为负时当作没有房间 */
+class HeatFlowRegulator {
+    Room** house;
+    FurnaceController* heater;
+    int room_num;
+    unsigned int cycle;
+    TelemetryRing* telemetry;
+
+    HeatFlowRegulator(const HeatFlowRegulator&);
+    HeatFlowRegulator& operator=(const HeatFlowRegulator&);
+
+public:
+    HeatFlowRegulator(FurnaceController*, int, Room**);
+    ~HeatFlowRegulator();
+    int attach_telemetry(TelemetryRing*);
+    FurnaceController* get_controller();
+    int loop();
+};
+
+/* 按炉子并行调节: 每个炉子的调节器是一个任务, 彼此之间没有共享状态(房间, 控制器, 遥测都各自独立).
+   每个工作线程在每个周期分到一段连续的任务, 做完自己的再去其他线程那里偷, 取任务只是对
+   该段的 next 做一次 fetch_add, 不需要锁. 调用 run_cycle 的线程本身就是 0 号工作线程,
+   线程数为 1 时退化为原来的单线程顺序执行.
+   各段的 next 被不同线程频繁修改, 不能落在同一个缓存行里. new 出来的数组只保证 16 字节对齐,
+   所以 WorkRange 在 next 前后都填充一整个缓存行, 无论数组从哪里开始, 相邻两段的 next 之间
+   至少隔着 cache_line 个字节 */
+const int cache_line = 64;
+
+class RegulationScheduler {
+    struct WorkRange {
+        char pad_before[cache_line];
+        std::atomic<int> next;
+        int begin;
+        int end;
+        char pad_after[cache_line];
+    };
+
+    HeatFlowRegulator** regulators;
+    int regulator_num;
+    int thread_num;
+    WorkRange* ranges;
+    std::thread* threads;
+    std::atomic<int> pending;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    unsigned int generation;
+    int stopping;
+    std::chrono::microseconds period;
+    std::chrono::steady_clock::time_point deadline;
+
+    RegulationScheduler(const RegulationScheduler&);
+    RegulationScheduler& operator=(const RegulationScheduler&);
+    void worker_main(int);
+    void execute(int);
+
+public:
+    RegulationScheduler(HeatFlowRegulator**, int, int, long);
+    ~RegulationScheduler();
+    int get_thread_num();
+    void run_cycle();
+    void wait_next_period();
+};
+
+/* 建筑描述文件是逐行的文本, # 开头的行是注释, 每行一条声明:
+       furnace <名字> [最短运行周期] [最短停机周期] [点火房间数] [熄火房间数]
+       zone <名字> <炉子名>
+       room <名字> <区域名> <传感器编号> [无人阈值] [有人阈值]
+   被引用的炉子和区域必须先声明. 建筑对象拥有所有房间, 炉子和调节器 */
+class Building {
+    struct FurnaceSpec {
+        int min_on;
+        int min_off;
+        int on_level;       ///< 没有给出时为 0, wire 时按该炉子的房间数取 band_on_level
+        int off_level;
+    };
+
+    std::vector<Room> rooms;
+    std::vector<int> room_furnace;
+    std::vector<FurnaceSpec> specs;
+    std::vector<int> zone_furnace;
+    std::map<std::string, int> furnace_ids;
+    std::map<std::string, int> zone_ids;
+    std::string last_zone;
+    int last_zone_id;
+    Furnace* furnaces;
+    FurnaceController** controls;
+    HeatFlowRegulator** regulators;
+    Room** order;
+    int furnace_num;
+    int loaded;
+
+    Building(const Building&);
+    Building& operator=(const Building&);
+    int parse_line(char*, int);
+    void wire();
+    void clear();
+
+public:
+    Building();
+    ~Building();
+    int load(const char*);
+    int get_room_num();
+    int get_zone_num();
+    int get_furnace_num();
+    HeatFlowRegulator** get_regulators();
+};
+
+/* 合成的供暖系统: room_num 个房间按顺序平均分给 furnace_num 台炉子, 每台炉子一个控制器
+   和一个调节器, 控制器使用默认的滞回带和最短保持时间. 基准测试和负载驱动都用它建立被测对象 */
+class SyntheticPlant {
+    Room** rooms;
+    Furnace* furnaces;
+    FurnaceController** controls;
+    HeatFlowRegulator** regulators;
+    int room_num;
+    int furnace_num;
+
+    SyntheticPlant(const SyntheticPlant&);
+    SyntheticPlant& operator=(const SyntheticPlant&);
+
+public:
+    SyntheticPlant(int, int);
+    ~SyntheticPlant();
+    int get_room_num();
+    int get_furnace_num();
+    HeatFlowRegulator** get_regulators();
+};
+
+#endif
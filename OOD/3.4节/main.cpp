@@ -1,140 +1,266 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+
+#include "heating.h"
+#include "alloc_count.h"
+
+/* HDR 风格的延迟直方图: 数值按 2 的幂分段, 每段再线性地分成 sub_count 个桶,
+   相对误差不超过 1/sub_count, 整个直方图是固定大小的计数数组, 记录时不分配内存 */
+const int sub_bits = 7;
+const int sub_count = 1 << sub_bits;
+const int bucket_len = (64 - sub_bits + 1) * sub_count;
+
+class LatencyHistogram {
+    unsigned long long counts[bucket_len];
+    unsigned long long total;
+    unsigned long long min_value;
+    unsigned long long max_value;
+    double sum;
+
+    static int index_of(unsigned long long);
+    static unsigned long long highest_of(int);
 
-///< 例子中用到的常量
-const int name_len = 50;
-const int large_strlen = 128;
-const int room_len = 20;
-
-///< 输入期望温度的设备
-class DesiredTempActuator {
 public:
-    int get_temp();
+    LatencyHistogram();
+    void record(unsigned long long);
+    unsigned long long percentile(double);
+    void print(const char*);
 };
 
-int DesiredTempActuator::get_temp()
+LatencyHistogram::LatencyHistogram()
 {
-    return (rand() % 40) + 50;
+    memset(counts, 0, sizeof(counts));
+    total = 0;
+    min_value = ~0ULL;
+    max_value = 0;
+    sum = 0;
 }
 
-///< 实际温度探测器
-class ActualTempSensor {
-public:
-    int get_temp();
-};
-
-int ActualTempSensor::get_temp()
+int LatencyHistogram::index_of(unsigned long long v)
 {
-    return (rand() % 40) + 50;
-}
-
-///< 探测房内是否有人
-class OccupancySensor {
-public:
-    int anyone_in_room();
-};
+    int shift = 0;
 
-int OccupancySensor::anyone_in_room()
-{
-    return (rand() % 2);
+    if (v < (unsigned long long)sub_count) {
+        return (int)v;
+    }
+    while ((v >> shift) >= (unsigned long long)(2 * sub_count)) {
+        ++shift;
+    }
+    return (shift + 1) * sub_count + (int)((v >> shift) - sub_count);
 }
 
-///< 房间内包含上述三种设备, 并且有一个名字属性, 用来存放描述信息
-class Room {
-    char name[name_len];
-    DesiredTempActuator dtemp;
-    ActualTempSensor atemp;
-    OccupancySensor occ;
+///< 桶所代表的最大值, 与 HdrHistogram 的 highestEquivalentValue 含义相同
+unsigned long long LatencyHistogram::highest_of(int idx)
+{
+    int shift;
 
-public:
-    Room(char*);
-    int do_you_need_heat();
-};
+    if (idx < sub_count) {
+        return idx;
+    }
+    shift = idx / sub_count - 1;
+    return (((unsigned long long)(sub_count + idx % sub_count) + 1) << shift) - 1;
+}
 
-Room::Room(char* n)
+void LatencyHistogram::record(unsigned long long v)
 {
-    strncpy(name, n, name_len);
+    ++counts[index_of(v)];
+    ++total;
+    sum += (double)v;
+    if (v < min_value) {
+        min_value = v;
+    }
+    if (v > max_value) {
+        max_value = v;
+    }
 }
 
-///< 房间对象通过计算工作(期待温度-实际温度) 并检查房内是否有人来判断是否需要供暖
-
-int Room::do_you_need_heat()
+unsigned long long LatencyHistogram::percentile(double p)
 {
-    int work_temp, occupied;
-
-    work_temp = dtemp.get_temp() - atemp.get_temp();
-    occupied = occ.anyone_in_room();
-
-    std::cout << " The " << name << " has a working temp of " << work_temp;
-    std::cout << " and " << (occupied ? "someone in the room.\n" : "no one in the rom.\n");
+    unsigned long long rank, seen = 0;
+    int i;
 
-    if (work_temp > 5 && !occupied || work_temp > 0 && occupied) {
-        return 1;
+    if (total == 0) {
+        return 0;
     }
-    return 0;
+    rank = (unsigned long long)(p / 100.0 * total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (i = 0; i < bucket_len; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return highest_of(i) < max_value ? highest_of(i) : max_value;
+        }
+    }
+    return max_value;
 }
 
-/* 供暖炉子不值得特别关注 */
-class Furnace {
-public:
-    void provide_heat();
-    void turnoff();
-};
-
-void Furnace::provide_heat()
+/* 输出格式仿照 HdrHistogram 的 outputPercentileDistribution, 单位为微秒 */
+void LatencyHistogram::print(const char* title)
 {
-    std::cout << "Furnamce Running \n";
+    static const double points[] = { 0, 50, 75, 90, 99, 99.9, 99.99, 100 };
+    char line[large_strlen];
+    unsigned long long rank;
+    int i;
+
+    std::cout << title << "\n";
+    std::cout << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+    for (i = 0; i < (int)(sizeof(points) / sizeof(points[0])); ++i) {
+        rank = (unsigned long long)(points[i] / 100.0 * total + 0.5);
+        if (points[i] < 100) {
+            sprintf(line, "%12.3f %14.12f %10llu %14.2f\n", percentile(points[i]) / 1000.0,
+                points[i] / 100.0, rank, 1.0 / (1.0 - points[i] / 100.0));
+        } else {
+            sprintf(line, "%12.3f %14.12f %10llu            inf\n", percentile(points[i]) / 1000.0,
+                1.0, total);
+        }
+        std::cout << line;
+    }
+    sprintf(line, "#[Mean    = %12.3f, Min       = %12.3f]\n", total ? sum / total / 1000.0 : 0.0,
+        total ? min_value / 1000.0 : 0.0);
+    std::cout << line;
+    sprintf(line, "#[Max     = %12.3f, Total count    = %10llu]\n", max_value / 1000.0, total);
+    std::cout << line;
+    sprintf(line, "#[p50 = %.3f us, p99 = %.3f us, p999 = %.3f us]\n", percentile(50) / 1000.0,
+        percentile(99) / 1000.0, percentile(99.9) / 1000.0);
+    std::cout << line;
 }
 
-void Furnace::turnoff()
+/* 按控制周期连续运行 cycle_num 个周期并输出延迟分布. 一个周期指所有调节器各执行一次 loop,
+   耗时超过 period_us 记为一次超时. 最后汇总所有炉子控制器的命令统计,
+   并给出单台炉子命令数的最小值和最大值 */
+void measure_cycles(HeatFlowRegulator** regulators, int regulator_num, int cycle_num, long period_us,
+    int thread_num)
 {
-    std::cout << "Furnace Turned Off \n";
+    LatencyHistogram* histogram = new LatencyHistogram;
+    RegulationScheduler scheduler(regulators, regulator_num, thread_num, period_us);
+    FurnaceController* control;
+    int c, i, misses = 0;
+    unsigned long allocs, requests = 0, actuations = 0, held = 0, least = 0, most = 0;
+    long long ns;
+
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    for (c = 0; c < cycle_num; ++c) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scheduler.run_cycle();
+        ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        histogram->record((unsigned long long)ns);
+        if (ns > period_us * 1000) {
+            ++misses;
+        }
+        scheduler.wait_next_period();
+    }
+    allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+
+    std::cout << "Worker threads: " << scheduler.get_thread_num() << "\n";
+    histogram->print("Cycle latency (us)");
+    std::cout << "Deadline misses: " << misses << " of " << cycle_num << "\n";
+    std::cout << "Allocations during cycles: " << allocs << "\n";
+    delete histogram;
+
+    for (i = 0; i < regulator_num; ++i) {
+        control = regulators[i]->get_controller();
+        requests += control->get_requests();
+        actuations += control->get_actuations();
+        held += control->get_held();
+        if (i == 0 || control->get_actuations() < least) {
+            least = control->get_actuations();
+        }
+        if (control->get_actuations() > most) {
+            most = control->get_actuations();
+        }
+    }
+    print_actuation_stats(requests, actuations, held);
+    std::cout << "Actuations per furnace: min " << least << ", max " << most << "\n";
 }
 
-/* 热流调节器并不包含房间的列表, 也不包含供暖的炉子. 塔筒他们是关联关系 */
-class HeatFlowRegulator {
-    Room* house[room_len];
-    Furnace* heater;
-    int room_num;
-
-public:
-    HeatFlowRegulator(Furnace*, int, Room**);
-    int loop();
-};
-
-HeatFlowRegulator::HeatFlowRegulator(Furnace* f, int num, Room** rooms) 
+/* 无人值守的基准测试: 构造 room_num 个房间, 平均分给 furnace_num 个炉子, 每个炉子一个调节器 */
+int run_benchmark(int room_num, int furnace_num, int cycle_num, long period_us, int thread_num)
 {
+    TelemetryRing** rings;
+    HeatFlowRegulator** regulators;
     int i;
 
-    heater = f;
-    room_num = num;
-    for (i = 0; i < room_num; ++i) {
-        house[i] = rooms[i];
+    if (room_num < 1 || furnace_num < 1 || cycle_num < 1) {
+        std::cout << "Error: rooms, furnaces and cycles must be positive.\n";
+        return 1;
+    }
+    verbose = 0;
+
+    SyntheticPlant plant(room_num, furnace_num);
+    furnace_num = plant.get_furnace_num();
+    regulators = plant.get_regulators();
+    rings = new TelemetryRing*[furnace_num];
+    for (i = 0; i < furnace_num; ++i) {
+        rings[i] = new TelemetryRing(telemetry_len);
+        if (!regulators[i]->attach_telemetry(rings[i])) {
+            delete rings[i];
+            rings[i] = NULL;
+        }
+    }
+
+    std::cout << "Rooms: " << room_num << ", furnaces: " << furnace_num;
+    std::cout << ", cycles: " << cycle_num << ", control period: " << period_us << " us\n";
+    measure_cycles(regulators, furnace_num, cycle_num, period_us, thread_num);
+
+    for (i = 0; i < furnace_num; ++i) {
+        delete rings[i];
     }
+    delete [] rings;
+
+    return 0;
 }
 
-/* 热流调节器的这个循环是为了检查每个房间是否需要供暖, 为了做到这一点,
-   调节器仅仅简单的查询房间是否需要供暖, 而真正的判断交给房间类 */
-int HeatFlowRegulator::loop()
+/* 从建筑描述文件构造整个供暖系统, 报告载入耗时, 然后运行 cycle_num 个周期 */
+int run_building(const char* path, int cycle_num, long period_us, int thread_num)
 {
-    int any_need_heat = 0, i;
+    Building building;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    for (i = 0; i < room_num; ++i) {
-        any_need_heat += house[i]->do_you_need_heat();
+    verbose = 0;
+    if (!building.load(path)) {
+        return 1;
     }
-    if (any_need_heat) {
-        heater->provide_heat();
-    } else {
-        heater->turnoff();
+    std::cout << "Loaded " << building.get_room_num() << " rooms, " << building.get_zone_num();
+    std::cout << " zones, " << building.get_furnace_num() << " furnaces in ";
+    std::cout << std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count() / 1000.0 << " ms\n";
+    if (cycle_num > 0) {
+        measure_cycles(building.get_regulators(), building.get_furnace_num(), cycle_num, period_us,
+            thread_num);
     }
-
-    return any_need_heat;
+    return 0;
 }
 
-int main()
+/* 带参数 bench 启动时运行基准测试: bench [房间数] [炉子数] [周期数] [控制周期(微秒)] [线程数],
+   带参数 load 启动时从文件构造建筑: load <描述文件> [周期数] [控制周期(微秒)] [线程数],
+   否则进入原来的交互式演示. 线程数默认取 CPU 核数.
+   演示时给出 demo <遥测文件> 才会在退出时把遥测写到该文件, 否则不写任何文件 */
+int main(int argc, char** argv)
 {
     int room_num, i, retval;
+    int cores = (int)std::thread::hardware_concurrency();
+    const char* telemetry_path = NULL;
+
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+        return run_benchmark(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? atoi(argv[3]) : 10,
+            argc > 4 ? atoi(argv[4]) : 1000, argc > 5 ? atol(argv[5]) : 1000,
+            argc > 6 ? atoi(argv[6]) : cores);
+    }
+    if (argc > 2 && !strcmp(argv[1], "load")) {
+        return run_building(argv[2], argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? atol(argv[4]) : 1000,
+            argc > 5 ? atoi(argv[5]) : cores);
+    }
+    if (argc > 2 && !strcmp(argv[1], "demo")) {
+        telemetry_path = argv[2];
+    }
+
     Furnace our_furnace;
     Room* rooms[room_len];
     char buffer[large_strlen];
@@ -145,6 +271,9 @@ int main()
     if (room_num > room_len) {
         room_num = room_len;
     }
+    if (room_num < 0) {
+        room_num = 0;
+    }
 
     for (i = 0; i < room_num; ++i) {
         std::cout << " What is the name of room[ " << i + 1 << "]?";
@@ -152,7 +281,11 @@ int main()
         rooms[i] = new Room(buffer);
     }
 
-    HeatFlowRegulator h(&our_furnace, room_num, rooms);
+    FurnaceController control(&our_furnace, min_on_cycles, min_off_cycles, band_on_level(room_num),
+        default_off_level);
+    HeatFlowRegulator h(&control, room_num, rooms);
+    TelemetryRing telemetry(telemetry_len);
+    h.attach_telemetry(&telemetry);
 
     do {
         retval = h.loop();
@@ -161,8 +294,17 @@ int main()
         std::cin.getline(buffer, large_strlen, '\n');
     } while (buffer[0] == 'y');
 
-    return 0;
-}
-
+    control.print_stats();
 
+    /* 遥测只在退出时才落盘, 控制循环中不做任何 I/O */
+    if (telemetry_path != NULL) {
+        std::ofstream out(telemetry_path, std::ios::binary);
+        if (!out) {
+            std::cout << "Error: cannot write " << telemetry_path << ".\n";
+            return 1;
+        }
+        std::cout << telemetry.dump(out) << " telemetry records written to " << telemetry_path << "\n";
+    }
 
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "../3.4节/heating.h"
+#include "workloads.h"
+
+const int rooms_per_scale = 10;
+const int rooms_per_furnace = 100;
+const int heating_cycles = 200;
+
+/* 用 3.4节 的 SyntheticPlant 建立被测对象, 与 3.4节 的 bench 模式相同.
+   控制周期之间不等待, 连续运行, 测的是一个周期本身的耗时 */
+int run_heating_workload(int scale, int thread_num, Report& r)
+{
+    int room_num = rooms_per_scale * scale, c;
+    unsigned long allocs;
+
+    if (scale < 1) {
+        return 1;
+    }
+    verbose = 0;
+
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    SyntheticPlant plant(room_num, room_num / rooms_per_furnace);
+    LatencySamples samples(heating_cycles);
+    RegulationScheduler scheduler(plant.get_regulators(), plant.get_furnace_num(), thread_num, 0);
+    r.name = "heating";
+    r.unit = "cycles";
+    r.scale = scale;
+    r.threads = scheduler.get_thread_num();
+    r.ops = heating_cycles;
+    r.items = (long long)heating_cycles * room_num;
+    r.setup_allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    for (c = 0; c < heating_cycles; ++c) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scheduler.run_cycle();
+        samples.record(start);
+    }
+    r.run_allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+    finish_report(r, samples, begin);
+    return 0;
+}
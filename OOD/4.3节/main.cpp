@@ -0,0 +1,182 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "workloads.h"
+
+///< 非交互的负载驱动: 用合成负载运行 3.3节, 3.4节 和 9_9桥接模式 的模型, 以 JSON 输出测量结果
+
+LatencySamples::LatencySamples(int num)
+{
+    samples.reserve(num);
+}
+
+void LatencySamples::record(std::chrono::steady_clock::time_point start)
+{
+    samples.push_back((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+int LatencySamples::get_sample_num()
+{
+    return (int)samples.size();
+}
+
+/* 最近秩法取分位数. 只在测量结束后调用, 排序不影响计时 */
+unsigned long long LatencySamples::percentile(double p)
+{
+    size_t rank;
+
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    rank = (size_t)(p / 100.0 * samples.size() + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > samples.size()) {
+        rank = samples.size();
+    }
+    return samples[rank - 1];
+}
+
+void finish_report(Report& r, LatencySamples& samples, std::chrono::steady_clock::time_point start)
+{
+    r.seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count() / 1e9;
+    r.p50_ns = samples.percentile(50);
+    r.p90_ns = samples.percentile(90);
+    r.p99_ns = samples.percentile(99);
+    r.max_ns = samples.percentile(100);
+}
+
+///< 进程到目前为止的峰值常驻内存, 单位 KB
+long peak_rss_kb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return -1;
+    }
+    return (long)(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return (long)(usage.ru_maxrss / 1024);
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+void print_report(std::ostream& out, const Report& r)
+{
+    out << "    {\n";
+    out << "      \"name\": \"" << r.name << "\",\n";
+    out << "      \"unit\": \"" << r.unit << "\",\n";
+    out << "      \"scale\": " << r.scale << ",\n";
+    out << "      \"threads\": " << r.threads << ",\n";
+    out << "      \"ops\": " << r.ops << ",\n";
+    out << "      \"items\": " << r.items << ",\n";
+    out << "      \"seconds\": " << r.seconds << ",\n";
+    out << "      \"ops_per_sec\": " << (r.seconds > 0 ? r.ops / r.seconds : 0.0) << ",\n";
+    out << "      \"items_per_sec\": " << (r.seconds > 0 ? r.items / r.seconds : 0.0) << ",\n";
+    out << "      \"latency_ns\": { \"p50\": " << r.p50_ns << ", \"p90\": " << r.p90_ns;
+    out << ", \"p99\": " << r.p99_ns << ", \"max\": " << r.max_ns << " },\n";
+    out << "      \"allocations\": { \"setup\": " << r.setup_allocs << ", \"run\": " << r.run_allocs << " },\n";
+    out << "      \"process_peak_rss_kb\": " << r.process_peak_rss_kb;
+    if (r.instrumented) {
+        out << ",\n      \"instrument\": ";
+        instrument_export(out, r.instrument);
+    }
+    out << "\n";
+    out << "    }";
+}
+
+const int workload_num = 3;
+const char* workload_names[workload_num] = { "registration", "heating", "rendering" };
+
+int run_workload(int which, int scale, int thread_num, Report& r)
+{
+    switch (which) {
+    case 0:
+        return run_registration_workload(scale, r);
+    case 1:
+        return run_heating_workload(scale, thread_num, r);
+    default:
+        return run_rendering_workload(scale, thread_num, r);
+    }
+}
+
+/* 用法: 4.3节 [all|registration|heating|rendering] [scale=1000] [threads=cores] [report.json]
+   没有给出报告文件时 JSON 写到标准输出, 出错信息写到标准错误, 不会混进报告.
+   用 OOD_INSTRUMENT 编译时, 选课负载的报告中还有计时阶段的热路径计数 */
+int main(int argc, char** argv)
+{
+    const char* which = argc > 1 ? argv[1] : "all";
+    int scale = argc > 2 ? atoi(argv[2]) : 1000;
+    int thread_num = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    std::vector<Report> reports;
+    std::ofstream file;
+    Report r;
+    int i;
+
+    if (scale < 1) {
+        std::cerr << "Error: scale must be positive.\n";
+        return 1;
+    }
+    for (i = 0; i < workload_num; ++i) {
+        if (strcmp(which, "all") && strcmp(which, workload_names[i])) {
+            continue;
+        }
+        memset(&r, 0, sizeof(r));
+        if (run_workload(i, scale, thread_num, r)) {
+            std::cerr << "Error: the " << workload_names[i] << " workload failed.\n";
+            return 1;
+        }
+        r.process_peak_rss_kb = peak_rss_kb();
+        reports.push_back(r);
+    }
+    if (reports.empty()) {
+        std::cerr << "Error: unknown workload " << which << ".\n";
+        return 1;
+    }
+
+    if (argc > 4) {
+        file.open(argv[4]);
+        if (!file) {
+            std::cerr << "Error: cannot write " << argv[4] << ".\n";
+            return 1;
+        }
+    }
+    std::ostream& out = argc > 4 ? file : std::cout;
+    out << "{\n";
+    out << "  \"workloads\": [\n";
+    for (i = 0; i < (int)reports.size(); ++i) {
+        print_report(out, reports[i]);
+        out << (i + 1 < (int)reports.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+    out << "  \"peak_rss_kb\": " << peak_rss_kb() << "\n";
+    out << "}\n";
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cstdio>
+
+#include "../3.3节/registration.h"
+#include "../3.3节/instrument.h"
+#include "../9_9桥接模式/bridge.h"
+#include "workloads.h"
+
+const int courses_per_student = 8;
+const int requests_per_course = 10;
+
+/* 科目 i (i > 0) 以科目 (i - 1) / 2 为先修科目, 每门科目开一门课程.
+   学生事先修过若干门随机的科目. 每次选课请求按名字找到学生和课程, 让课程检查先修科目,
+   再复制一份学生的科目清单(相当于打印成绩单), 这样查找, find_all 和列表拷贝都在热路径上.
+   列表按 科目, 学生, 课程 的顺序声明, 析构时先释放课程, 再释放学生, 最后释放科目 */
+int run_registration_workload(int scale, Report& r)
+{
+    int course_num = scale, student_num = 4 * scale, request_num = requests_per_course * scale;
+    char name[name_len], description[desc_len], date[small_strlen], room[small_strlen];
+    char ssn[small_strlen];
+    unsigned long seed = 1, allocs;
+    Course** made;
+    Student* student;
+    CourseOffering* offering;
+    int i, k;
+
+    if (scale < 1) {
+        return 1;
+    }
+    registration_verbose = 0;
+    sprintf(date, "2026-09-01");
+
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    CourseList courses(course_num);
+    StudentList students(student_num);
+    OfferingList offerings(course_num);
+    made = new Course*[course_num];
+    for (i = 0; i < course_num; ++i) {
+        sprintf(name, "course%d", i);
+        sprintf(description, "Synthetic course %d", i);
+        made[i] = new Course(name, description, 30, 0);
+        if (i > 0) {
+            made[i]->add_prereq(*made[(i - 1) / 2]);
+        }
+        courses.add_item(*made[i]);
+        sprintf(room, "room%d", i % 100);
+        offerings.add_item(*new CourseOffering(*made[i], room, date));
+    }
+    for (i = 0; i < student_num; ++i) {
+        sprintf(name, "student%d", i);
+        sprintf(ssn, "%09d", i);
+        student = new Student(name, ssn, 18 + i % 10, 0);
+        for (k = 0; k < courses_per_student; ++k) {
+            student->add_course(*made[next_index(seed, course_num)]);
+        }
+        students.add_item(*student);
+    }
+    delete [] made;
+
+    LatencySamples samples(request_num);
+    r.name = "registration";
+    r.unit = "requests";
+    r.scale = scale;
+    r.threads = 1;
+    r.ops = request_num;
+    r.items = request_num;
+    r.setup_allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+
+    ///< 热路径计数只统计计时阶段
+    instrument_reset();
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    for (i = 0; i < request_num; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sprintf(name, "student%d", next_index(seed, student_num));
+        student = students.find_item(name);
+        sprintf(name, "course%d", next_index(seed, course_num));
+        offering = offerings.find_item(name, date);
+        if (student == NULL || offering == NULL) {
+            return 1;
+        }
+        offering->add_student(*student);
+        {
+            CourseList transcript(student->get_courses());
+        }
+        samples.record(start);
+    }
+    r.run_allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+    finish_report(r, samples, begin);
+    ///< 在列表析构之前取快照, 释放模型时的 detach_object 不计入
+    r.instrumented = instrument_enabled();
+    instrument_snapshot(r.instrument);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <vector>
+
+#include "../9_9桥接模式/bridge.h"
+#include "workloads.h"
+
+const int shapes_per_scale = 10;
+const int frame_width = 1920;
+const int frame_height = 1080;
+const int frame_num = 20;
+
+/* 用 9_9桥接模式 的混合基准场景生成形状, 放进一个 Scene 中按块并行渲染.
+   第一帧包含记录线段的开销, 不计时; 之后每帧清空帧缓冲再完整渲染一次 */
+int run_rendering_workload(int scale, int thread_num, Report& r)
+{
+    int shape_num = shapes_per_scale * scale, i;
+    std::vector<ShapeRecord> recs;
+    unsigned long allocs;
+
+    if (scale < 1) {
+        return 1;
+    }
+
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    Framebuffer fb(frame_width, frame_height);
+    Scene scene;
+    ThreadPool pool(thread_num);
+    make_suite_scene(mixed_scene, shape_num, frame_width, frame_height, recs);
+    for (i = 0; i < shape_num; ++i) {
+        scene.add(recs[i]);
+    }
+    scene.render<V2Drawing>(fb, pool);
+
+    LatencySamples samples(frame_num);
+    r.name = "rendering";
+    r.unit = "frames";
+    r.scale = scale;
+    r.threads = pool.get_thread_num();
+    r.ops = frame_num;
+    r.items = (long long)frame_num * shape_num;
+    r.setup_allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    allocs = alloc_count.load(std::memory_order_relaxed);
+    for (i = 0; i < frame_num; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fb.clear();
+        scene.render<V2Drawing>(fb, pool);
+        samples.record(start);
+    }
+    r.run_allocs = alloc_count.load(std::memory_order_relaxed) - allocs;
+    finish_report(r, samples, begin);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef WORKLOADS_H
+#define WORKLOADS_H
+
+#include <chrono>
+#include <vector>
+
+#include "../3.3节/instrument.h"
+#include "../3.4节/alloc_count.h"
+
+/* 一次操作的耗时样本. 样本数组在计时开始前按操作数预留好,
+   记录时不分配内存, 不会计入被测阶段的分配次数 */
+class LatencySamples {
+    std::vector<unsigned long long> samples;
+
+public:
+    LatencySamples(int);
+    void record(std::chrono::steady_clock::time_point start);
+    int get_sample_num();
+    unsigned long long percentile(double p);
+};
+
+/* 一个负载的测量结果, 由 main.cpp 统一输出成 JSON.
+   setup_allocs 是建立模型时的分配次数, run_allocs 是计时阶段的分配次数.
+   process_peak_rss_kb 是该负载结束时整个进程到目前为止的峰值, 不是这个负载单独的峰值.
+   instrumented 非 0 时, instrument 是计时阶段结束时取得的热路径计数 */
+struct Report {
+    const char* name;
+    const char* unit;
+    int scale;
+    int threads;
+    long long ops;
+    long long items;
+    double seconds;
+    unsigned long long p50_ns, p90_ns, p99_ns, max_ns;
+    unsigned long setup_allocs;
+    unsigned long run_allocs;
+    long process_peak_rss_kb;
+    int instrumented;
+    InstrumentTotals instrument;
+};
+
+///< 把计时结果和分位数填入报告
+void finish_report(Report& r, LatencySamples& samples, std::chrono::steady_clock::time_point start);
+
+/* 三个负载, scale 决定模型的规模:
+   选课: scale 门科目, 4 * scale 个学生, 10 * scale 次选课请求, 每次请求是一个操作;
+   供暖: 10 * scale 个房间, 每 100 个房间一台炉子, 200 个控制周期, 每个周期是一个操作;
+   绘图: 10 * scale 个形状, 1920x1080 分块渲染 20 帧, 每帧是一个操作.
+   出错时返回非 0 */
+int run_registration_workload(int scale, Report& r);
+int run_heating_workload(int scale, int thread_num, Report& r);
+int run_rendering_workload(int scale, int thread_num, Report& r);
+
+#endif
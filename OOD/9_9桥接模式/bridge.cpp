@@ -0,0 +1,820 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <climits>
+
+#include "bridge.h"
+
+Framebuffer::Framebuffer(int w, int h)
+{
+    width = w;
+    height = h;
+    pixels = new unsigned char[(size_t)width * height];
+    clear();
+}
+
+Framebuffer::~Framebuffer()
+{
+    delete [] pixels;
+}
+
+void Framebuffer::clear()
+{
+    memset(pixels, 0, (size_t)width * height);
+}
+
+int Framebuffer::get_width()
+{
+    return width;
+}
+
+int Framebuffer::get_height()
+{
+    return height;
+}
+
+///< 比较两块帧缓冲的内容, 用来确认两种实现画出的像素完全相同
+int Framebuffer::same_as(Framebuffer& rhs)
+{
+    return (width == rhs.width && height == rhs.height &&
+        !memcmp(pixels, rhs.pixels, (size_t)width * height));
+}
+
+///< 小图用字符打印出来, 演示时可以直接看到结果
+void Framebuffer::print()
+{
+    int x, y;
+    for (y = 0; y < height; ++y) {
+        for (x = 0; x < width; ++x) {
+            std::cout << (row(y)[x] ? '#' : '.');
+        }
+        std::cout << "\n";
+    }
+}
+
+/* PGM(P5) 是 Netpbm 中的灰度格式, 文件头之后就是按行排列的原始像素,
+   与帧缓冲的内存布局完全一致, 所以整块像素一次写出, 不做任何转换或拷贝 */
+int Framebuffer::write_pgm(std::ostream& out)
+{
+    out << "P5\n" << width << " " << height << "\n255\n";
+    out.write((const char*)pixels, (std::streamsize)width * height);
+    return out.good();
+}
+
+///< 读入与本帧缓冲尺寸相同的 P5 图像, 用来载入基准图像; 格式或尺寸不符时返回 0
+int Framebuffer::read_pgm(std::istream& in)
+{
+    std::string magic;
+    int w, h, maxval;
+
+    in >> magic >> w >> h >> maxval;
+    if (!in || magic != "P5" || w != width || h != height || maxval != 255) {
+        return 0;
+    }
+    in.get();
+    in.read((char*)pixels, (std::streamsize)width * height);
+    return in.good();
+}
+
+unsigned long PngStream::crc_table[256];
+
+void PngStream::make_crc_table()
+{
+    unsigned long c;
+    int n, k;
+
+    if (crc_table[1]) {
+        return;
+    }
+    for (n = 0; n < 256; ++n) {
+        c = (unsigned long)n;
+        for (k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+PngStream::PngStream(std::ostream& o)
+{
+    make_crc_table();
+    out = &o;
+    crc = 0;
+    adler_a = 1;
+    adler_b = 0;
+    block_left = 0;
+    data_left = 0;
+}
+
+///< 存储块每块最多 65535 字节, 每块有 5 字节的块头; zlib 另有 2 字节头和 4 字节 Adler32
+unsigned long PngStream::zlib_size(unsigned long raw)
+{
+    unsigned long blocks = raw ? (raw + 65534) / 65535 : 1;
+    return 2 + blocks * 5 + raw + 4;
+}
+
+void PngStream::begin_chunk(const char* type, unsigned long len)
+{
+    put_u32(len);
+    crc = 0xFFFFFFFFUL;
+    put((const unsigned char*)type, 4);
+}
+
+void PngStream::put(const unsigned char* p, unsigned long n)
+{
+    unsigned long i;
+
+    for (i = 0; i < n; ++i) {
+        crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    out->write((const char*)p, (std::streamsize)n);
+}
+
+///< PNG 中的整数都是大端序
+void PngStream::put_u32(unsigned long v)
+{
+    unsigned char b[4];
+
+    b[0] = (unsigned char)(v >> 24);
+    b[1] = (unsigned char)(v >> 16);
+    b[2] = (unsigned char)(v >> 8);
+    b[3] = (unsigned char)v;
+    put(b, 4);
+}
+
+void PngStream::end_chunk()
+{
+    put_u32(crc ^ 0xFFFFFFFFUL);
+}
+
+void PngStream::begin_zlib(unsigned long raw)
+{
+    static const unsigned char header[2] = { 0x78, 0x01 };
+
+    put(header, 2);
+    data_left = raw;
+    block_left = 0;
+    if (raw == 0) {
+        static const unsigned char empty[5] = { 1, 0, 0, 0xFF, 0xFF };
+        put(empty, 5);
+    }
+}
+
+///< 写入未压缩数据, 必要时插入存储块的块头; 数据本身直接从调用者的缓冲区写出
+void PngStream::put_data(const unsigned char* p, unsigned long n)
+{
+    unsigned char head[5];
+    unsigned long len, i;
+
+    while (n) {
+        if (block_left == 0) {
+            block_left = data_left < 65535 ? data_left : 65535;
+            head[0] = (unsigned char)(block_left == data_left ? 1 : 0);
+            head[1] = (unsigned char)block_left;
+            head[2] = (unsigned char)(block_left >> 8);
+            head[3] = (unsigned char)~head[1];
+            head[4] = (unsigned char)~head[2];
+            put(head, 5);
+        }
+        len = n < block_left ? n : block_left;
+        for (i = 0; i < len; ++i) {
+            adler_a = (adler_a + p[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+        put(p, len);
+        p += len;
+        n -= len;
+        block_left -= len;
+        data_left -= len;
+    }
+}
+
+void PngStream::end_zlib()
+{
+    put_u32((adler_b << 16) | adler_a);
+}
+
+/* 每行前面有一个过滤类型字节(0 表示不过滤), 后面紧跟该行的原始像素 */
+int Framebuffer::write_png(std::ostream& out)
+{
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const unsigned char no_filter = 0;
+    unsigned char ihdr_tail[5] = { 8, 0, 0, 0, 0 };
+    unsigned long raw = (unsigned long)(width + 1) * height;
+    PngStream png(out);
+    int y;
+
+    out.write((const char*)signature, 8);
+    png.begin_chunk("IHDR", 13);
+    png.put_u32(width);
+    png.put_u32(height);
+    png.put(ihdr_tail, 5);
+    png.end_chunk();
+
+    png.begin_chunk("IDAT", PngStream::zlib_size(raw));
+    png.begin_zlib(raw);
+    for (y = 0; y < height; ++y) {
+        png.put_data(&no_filter, 1);
+        png.put_data(row(y), width);
+    }
+    png.end_zlib();
+    png.end_chunk();
+
+    png.begin_chunk("IEND", 0);
+    png.end_chunk();
+    return out.good();
+}
+
+Drawing::~Drawing()
+{
+}
+
+void Drawing::drawLines(const LineSegment* lines, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        drawLine(lines[i].x1, lines[i].y1, lines[i].x2, lines[i].y2);
+    }
+}
+
+DrawCommandBuffer::DrawCommandBuffer(Drawing* dp, int batch)
+{
+    command_num = 0;
+    limit = batch < 1 ? 1 : batch > batch_len ? batch_len : batch;
+    target = dp;
+}
+
+DrawCommandBuffer::~DrawCommandBuffer()
+{
+    flush();
+}
+
+///< 换一个目标实现之前, 先把发往旧目标的命令提交掉
+void DrawCommandBuffer::retarget(Drawing* dp)
+{
+    if (dp != target) {
+        flush();
+        target = dp;
+    }
+}
+
+void DrawCommandBuffer::add_line(double x1, double y1, double x2, double y2)
+{
+    LineSegment& l = commands[command_num];
+
+    l.x1 = x1;
+    l.y1 = y1;
+    l.x2 = x2;
+    l.y2 = y2;
+    if (++command_num == limit) {
+        flush();
+    }
+}
+
+void DrawCommandBuffer::flush()
+{
+    if (command_num) {
+        target->drawLines(commands, command_num);
+        command_num = 0;
+    }
+}
+
+V1Drawing::V1Drawing(Framebuffer& f)
+    : ClippedDrawing<V1Drawing>(f)
+{
+}
+
+V2Drawing::V2Drawing(Framebuffer& f)
+    : ClippedDrawing<V2Drawing>(f)
+{
+}
+
+Shape::Shape(Drawing *dp)
+{
+    _dp = dp;
+}
+
+Shape::~Shape()
+{
+}
+
+///< 单独绘制一个形状: 形状的所有线段合成一批, 通常只需要一次虚调用
+void Shape::draw()
+{
+    DrawCommandBuffer batch(_dp);
+    emit(batch);
+}
+
+///< 连续绘制多个形状时共用一个缓冲, 目标实现相同的形状的线段会合并到同一批里
+void Shape::draw(DrawCommandBuffer& batch)
+{
+    batch.retarget(_dp);
+    emit(batch);
+}
+
+int circle_segments(double r)
+{
+    int n = (int)std::ceil(pi * r);
+
+    if (n < min_circle_segments) {
+        n = min_circle_segments;
+    }
+    if (n > max_circle_segments) {
+        n = max_circle_segments;
+    }
+    return n;
+}
+
+Rectangle::Rectangle(Drawing *dp, double x1, double y1, double x2, double y2)
+    : Shape(dp)
+{
+    _x1 = x1;
+    _y1 = y1;
+    _x2 = x2;
+    _y2 = y2;
+}
+
+void Rectangle::emit(DrawCommandBuffer& batch)
+{
+    emit_rectangle(batch, _x1, _y1, _x2, _y2);
+}
+
+///< 两个对角点的顺序任意
+BoundingBox Rectangle::bounds()
+{
+    BoundingBox b;
+
+    b.x0 = _x1 < _x2 ? _x1 : _x2;
+    b.y0 = _y1 < _y2 ? _y1 : _y2;
+    b.x1 = _x1 < _x2 ? _x2 : _x1;
+    b.y1 = _y1 < _y2 ? _y2 : _y1;
+    return b;
+}
+
+Circle::Circle(Drawing *dp, double x, double y, double r)
+    : Shape(dp)
+{
+    _x = x;
+    _y = y;
+    _r = r;
+    _segments = circle_segments(r);
+}
+
+void Circle::emit(DrawCommandBuffer& batch)
+{
+    emit_circle(batch, _x, _y, _r, _segments);
+}
+
+///< 内接多边形的顶点都在圆上, 所以外接正方形就是它的包围盒
+BoundingBox Circle::bounds()
+{
+    BoundingBox b;
+
+    b.x0 = _x - _r;
+    b.y0 = _y - _r;
+    b.x1 = _x + _r;
+    b.y1 = _y + _r;
+    return b;
+}
+
+ShapeRecord make_rectangle(double x1, double y1, double x2, double y2)
+{
+    ShapeRecord rec;
+
+    rec.kind = rectangle_kind;
+    rec.u.rect.x1 = x1;
+    rec.u.rect.y1 = y1;
+    rec.u.rect.x2 = x2;
+    rec.u.rect.y2 = y2;
+    return rec;
+}
+
+ShapeRecord make_circle(double x, double y, double r)
+{
+    ShapeRecord rec;
+
+    rec.kind = circle_kind;
+    rec.u.circle.x = x;
+    rec.u.circle.y = y;
+    rec.u.circle.r = r;
+    rec.u.circle.segments = circle_segments(r);
+    return rec;
+}
+
+Shape* make_shape(Drawing* dp, const ShapeRecord& rec)
+{
+    if (rec.kind == circle_kind) {
+        return new Circle(dp, rec.u.circle.x, rec.u.circle.y, rec.u.circle.r);
+    }
+    return new Rectangle(dp, rec.u.rect.x1, rec.u.rect.y1, rec.u.rect.x2, rec.u.rect.y2);
+}
+
+RecordingDrawing::RecordingDrawing(std::vector<LineSegment>& o)
+{
+    out = &o;
+}
+
+void RecordingDrawing::drawLine(double x1, double y1, double x2, double y2)
+{
+    LineSegment l = { x1, y1, x2, y2 };
+    out->push_back(l);
+}
+
+void RecordingDrawing::drawLines(const LineSegment* lines, int num)
+{
+    out->insert(out->end(), lines, lines + num);
+}
+
+TileJob::~TileJob()
+{
+}
+
+ThreadPool::ThreadPool(int num)
+{
+    int i;
+
+    thread_num = num < 1 ? 1 : num;
+    generation = 0;
+    stopping = 0;
+    job = NULL;
+    job_num = 0;
+    next.store(0);
+    remaining.store(0);
+    threads = new std::thread[thread_num];
+    for (i = 1; i < thread_num; ++i) {
+        threads[i] = std::thread(&ThreadPool::worker_main, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    int i;
+
+    {
+        std::lock_guard<std::mutex> guard(wake_lock);
+        stopping = 1;
+    }
+    wake.notify_all();
+    for (i = 1; i < thread_num; ++i) {
+        threads[i].join();
+    }
+    delete [] threads;
+}
+
+int ThreadPool::get_thread_num()
+{
+    return thread_num;
+}
+
+void ThreadPool::worker_main()
+{
+    unsigned int seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(wake_lock);
+            while (!stopping && generation == seen) {
+                wake.wait(guard);
+            }
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        execute();
+        remaining.fetch_sub(1);
+    }
+}
+
+void ThreadPool::execute()
+{
+    int task;
+    while ((task = next.fetch_add(1)) < job_num) {
+        job->run(task);
+    }
+}
+
+void ThreadPool::run(TileJob& j, int num)
+{
+    job = &j;
+    job_num = num;
+    next.store(0);
+    remaining.store(thread_num - 1);
+    if (thread_num > 1) {
+        {
+            std::lock_guard<std::mutex> guard(wake_lock);
+            ++generation;
+        }
+        wake.notify_all();
+    }
+    execute();
+    while (remaining.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+Scene::Scene()
+{
+    _recorded = 0;
+    _binned_width = 0;
+    _binned_height = 0;
+    _tiles_x = 0;
+    _tiles_y = 0;
+}
+
+Scene::~Scene()
+{
+    int i;
+    for (i = 0; i < (int)_shapes.size(); ++i) {
+        delete _shapes[i];
+    }
+}
+
+void Scene::add(const ShapeRecord& rec)
+{
+    _shapes.push_back(make_shape(NULL, rec));
+    _recorded = 0;
+}
+
+int Scene::get_shape_num()
+{
+    return (int)_shapes.size();
+}
+
+/* 记录所有形状的线段, 并算出每条线段在像素坐标下的包围盒. 光栅化只会走到两个端点
+   取整之后围成的矩形之内, 所以这个包围盒是精确的, 不需要外扩 */
+void Scene::record()
+{
+    RecordingDrawing recorder(_segments);
+    DrawCommandBuffer commands(&recorder);
+    int i, x0, y0, xe, ye;
+    int* b;
+
+    _segments.clear();
+    for (i = 0; i < (int)_shapes.size(); ++i) {
+        _shapes[i]->emit(commands);
+    }
+    commands.flush();
+
+    _bounds.resize(_segments.size() * 4);
+    for (i = 0; i < (int)_segments.size(); ++i) {
+        x0 = to_pixel(_segments[i].x1);
+        y0 = to_pixel(_segments[i].y1);
+        xe = to_pixel(_segments[i].x2);
+        ye = to_pixel(_segments[i].y2);
+        b = &_bounds[i * 4];
+        b[0] = x0 < xe ? x0 : xe;
+        b[1] = y0 < ye ? y0 : ye;
+        b[2] = x0 < xe ? xe : x0;
+        b[3] = y0 < ye ? ye : y0;
+    }
+    _recorded = 1;
+    _binned_width = 0;
+    _binned_height = 0;
+}
+
+/* 两遍计数排序把线段编号分到各块: 第一遍统计每块的线段数, 第二遍填入,
+   结果是 _tile_first / _tile_lines 组成的压缩数组, 不为每块单独分配内存 */
+void Scene::bin(int width, int height)
+{
+    int i, tx, ty, tx0, ty0, tx1, ty1, tile_num;
+    int pass;
+    const int* b;
+    std::vector<int> fill;
+
+    _tiles_x = (width + tile_len - 1) / tile_len;
+    _tiles_y = (height + tile_len - 1) / tile_len;
+    tile_num = _tiles_x * _tiles_y;
+    _tile_first.assign(tile_num + 1, 0);
+
+    for (pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            for (i = 0; i < tile_num; ++i) {
+                _tile_first[i + 1] += _tile_first[i];
+            }
+            _tile_lines.resize(_tile_first[tile_num]);
+            fill.assign(_tile_first.begin(), _tile_first.end() - 1);
+        }
+        for (i = 0; i < (int)_segments.size(); ++i) {
+            b = &_bounds[i * 4];
+            if (b[2] < 0 || b[3] < 0 || b[0] >= width || b[1] >= height) {
+                continue;
+            }
+            tx0 = b[0] < 0 ? 0 : b[0] / tile_len;
+            ty0 = b[1] < 0 ? 0 : b[1] / tile_len;
+            tx1 = b[2] >= width ? _tiles_x - 1 : b[2] / tile_len;
+            ty1 = b[3] >= height ? _tiles_y - 1 : b[3] / tile_len;
+            for (ty = ty0; ty <= ty1; ++ty) {
+                for (tx = tx0; tx <= tx1; ++tx) {
+                    if (pass == 0) {
+                        ++_tile_first[ty * _tiles_x + tx + 1];
+                    } else {
+                        _tile_lines[fill[ty * _tiles_x + tx]++] = i;
+                    }
+                }
+            }
+        }
+    }
+    _binned_width = width;
+    _binned_height = height;
+}
+
+void Scene::tile_rect(int tile, int& x0, int& y0, int& x1, int& y1)
+{
+    x0 = tile % _tiles_x * tile_len;
+    y0 = tile / _tiles_x * tile_len;
+    x1 = x0 + tile_len;
+    y1 = y0 + tile_len;
+}
+
+///< 把落在某块中的线段通过命令缓冲成批交给该块的实现
+void Scene::draw_tile(Drawing& dp, int tile)
+{
+    DrawCommandBuffer batch(&dp);
+    const LineSegment* l;
+    int i;
+
+    for (i = _tile_first[tile]; i < _tile_first[tile + 1]; ++i) {
+        l = &_segments[_tile_lines[i]];
+        batch.add_line(l->x1, l->y1, l->x2, l->y2);
+    }
+}
+
+ShapeIndex::ShapeIndex(Shape* const* shapes, int num)
+{
+    int i, pass, cx, cy, cx0, cy0, cx1, cy1;
+    double cell, w, h, extent, side;
+    std::vector<int> fill;
+
+    _boxes.resize(num);
+    _world.x0 = _world.y0 = 0;
+    _world.x1 = _world.y1 = 1;
+    for (i = 0; i < num; ++i) {
+        _boxes[i] = shapes[i]->bounds();
+        if (i == 0) {
+            _world = _boxes[i];
+        }
+        _world.x0 = _boxes[i].x0 < _world.x0 ? _boxes[i].x0 : _world.x0;
+        _world.y0 = _boxes[i].y0 < _world.y0 ? _boxes[i].y0 : _world.y0;
+        _world.x1 = _boxes[i].x1 > _world.x1 ? _boxes[i].x1 : _world.x1;
+        _world.y1 = _boxes[i].y1 > _world.y1 ? _boxes[i].y1 : _world.y1;
+    }
+
+    w = _world.x1 - _world.x0;
+    h = _world.y1 - _world.y0;
+    extent = 0;
+    for (i = 0; i < num; ++i) {
+        extent += (_boxes[i].x1 - _boxes[i].x0) + (_boxes[i].y1 - _boxes[i].y0);
+    }
+    extent /= 2.0 * (num ? num : 1);
+    cell = std::sqrt(w * h / (num ? num : 1));
+    if (cell < extent) {
+        cell = extent;
+    }
+    /* 包围盒都退化成线段时 w * h 为 0, 再要求较长的一边上不超过 num 个格子.
+       格子总数 (w / cell + 1) * (h / cell + 1) 因此不超过 num + 2 * num + 1 */
+    side = (w > h ? w : h) / (num ? num : 1);
+    if (cell < side) {
+        cell = side;
+    }
+    if (cell <= 0) {
+        cell = 1;
+    }
+    _inv_cell = 1.0 / cell;
+    _cells_x = (int)(w * _inv_cell) + 1;
+    _cells_y = (int)(h * _inv_cell) + 1;
+    _cell_first.assign(_cells_x * _cells_y + 1, 0);
+
+    for (pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            for (i = 0; i < _cells_x * _cells_y; ++i) {
+                _cell_first[i + 1] += _cell_first[i];
+            }
+            _cell_items.resize(_cell_first[_cells_x * _cells_y]);
+            fill.assign(_cell_first.begin(), _cell_first.end() - 1);
+        }
+        for (i = 0; i < num; ++i) {
+            cx0 = cell_x(_boxes[i].x0);
+            cy0 = cell_y(_boxes[i].y0);
+            cx1 = cell_x(_boxes[i].x1);
+            cy1 = cell_y(_boxes[i].y1);
+            for (cy = cy0; cy <= cy1; ++cy) {
+                for (cx = cx0; cx <= cx1; ++cx) {
+                    if (pass == 0) {
+                        ++_cell_first[cy * _cells_x + cx + 1];
+                    } else {
+                        _cell_items[fill[cy * _cells_x + cx]++] = i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int ShapeIndex::cell_x(double x) const
+{
+    int c = (int)((x - _world.x0) * _inv_cell);
+    return c < 0 ? 0 : c >= _cells_x ? _cells_x - 1 : c;
+}
+
+int ShapeIndex::cell_y(double y) const
+{
+    int c = (int)((y - _world.y0) * _inv_cell);
+    return c < 0 ? 0 : c >= _cells_y ? _cells_y - 1 : c;
+}
+
+int ShapeIndex::get_cell_num() const
+{
+    return _cells_x * _cells_y;
+}
+
+/* 拾取: 返回包围盒包含该点的所有形状编号(编号即构造时数组中的下标), 返回个数 */
+int ShapeIndex::query_point(double x, double y, std::vector<int>& out) const
+{
+    int i, cell, found = 0;
+    const BoundingBox* b;
+
+    out.clear();
+    if (x < _world.x0 || x > _world.x1 || y < _world.y0 || y > _world.y1) {
+        return 0;
+    }
+    cell = cell_y(y) * _cells_x + cell_x(x);
+    for (i = _cell_first[cell]; i < _cell_first[cell + 1]; ++i) {
+        b = &_boxes[_cell_items[i]];
+        if (x >= b->x0 && x <= b->x1 && y >= b->y0 && y <= b->y1) {
+            out.push_back(_cell_items[i]);
+            ++found;
+        }
+    }
+    return found;
+}
+
+/* 视口裁剪和框选: 返回包围盒与 view 相交的所有形状编号. 一个形状可能登记在多个格子里,
+   只在包含 "形状包围盒与 view 的交集的左上角" 的那个格子里报告它, 这样不需要额外的去重标记,
+   查询也不修改索引 */
+int ShapeIndex::query_rect(const BoundingBox& view, std::vector<int>& out) const
+{
+    int i, cx, cy, cx0, cy0, cx1, cy1, found = 0;
+    const BoundingBox* b;
+    double rx, ry;
+
+    out.clear();
+    if (view.x1 < _world.x0 || view.x0 > _world.x1 || view.y1 < _world.y0 || view.y0 > _world.y1) {
+        return 0;
+    }
+    cx0 = cell_x(view.x0);
+    cy0 = cell_y(view.y0);
+    cx1 = cell_x(view.x1);
+    cy1 = cell_y(view.y1);
+    for (cy = cy0; cy <= cy1; ++cy) {
+        for (cx = cx0; cx <= cx1; ++cx) {
+            const int cell = cy * _cells_x + cx;
+            for (i = _cell_first[cell]; i < _cell_first[cell + 1]; ++i) {
+                b = &_boxes[_cell_items[i]];
+                if (b->x1 < view.x0 || b->x0 > view.x1 || b->y1 < view.y0 || b->y0 > view.y1) {
+                    continue;
+                }
+                rx = b->x0 > view.x0 ? b->x0 : view.x0;
+                ry = b->y0 > view.y0 ? b->y0 : view.y0;
+                if (cell_x(rx) == cx && cell_y(ry) == cy) {
+                    out.push_back(_cell_items[i]);
+                    ++found;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+int next_index(unsigned long& seed, int n)
+{
+    unsigned long hi, lo;
+
+    seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+    hi = seed >> 16;
+    seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+    lo = seed >> 16;
+    return (int)(((hi << 15) | lo) % (unsigned long)n);
+}
+
+void make_suite_scene(int scene, int count, int width, int height, std::vector<ShapeRecord>& recs)
+{
+    unsigned long seed = 12345 + scene;
+    double x, y, sz;
+    int i, circle;
+
+    recs.clear();
+    recs.reserve(count);
+    for (i = 0; i < count; ++i) {
+        x = (double)next_index(seed, width);
+        y = (double)next_index(seed, height);
+        sz = 2 + (double)next_index(seed, 64);
+        circle = scene == circles_scene || (scene == mixed_scene && i % 2);
+        if (circle) {
+            recs.push_back(make_circle(x, y, sz / 2));
+        } else {
+            recs.push_back(make_rectangle(x, y, x + sz, y + sz * 0.75));
+        }
+    }
+}
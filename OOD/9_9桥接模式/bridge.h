@@ -0,0 +1,727 @@
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+///< 支持 SSE2 的平台上, V2Drawing 用 16 字节一次的写入来填充水平跨度
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BRIDGE_SSE2 1
+#endif
+
+/* 静态桥接的绘制循环中每条边都经过 DirectLines::add_line 调用一次 line, 调用点多,
+   编译器按体积估算时常常不肯内联, 所以这两个函数用 BRIDGE_INLINE 强制内联 */
+#if defined(_MSC_VER)
+#define BRIDGE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define BRIDGE_INLINE inline __attribute__((always_inline))
+#else
+#define BRIDGE_INLINE inline
+#endif
+
+///< 实现Bridget模式
+
+///< 例子中用到的常量
+const double pi = 3.14159265358979323846;
+const unsigned char ink = 255;
+const int min_circle_segments = 12;
+const int max_circle_segments = 720;
+const int batch_len = 256;
+const int tile_len = 128;
+
+/* 帧缓冲是一块 8 位灰度的内存图像, 按行连续存放, 两种 Drawing 实现都画到这里 */
+class Framebuffer {
+    unsigned char* pixels;
+    int width;
+    int height;
+
+    Framebuffer(const Framebuffer&);
+    Framebuffer& operator=(const Framebuffer&);
+
+public:
+    Framebuffer(int, int);
+    ~Framebuffer();
+    void clear();
+    int get_width();
+    int get_height();
+    unsigned char* row(int);
+    int same_as(Framebuffer&);
+    void print();
+    int write_pgm(std::ostream&);
+    int write_png(std::ostream&);
+    int read_pgm(std::istream&);
+};
+
+inline unsigned char* Framebuffer::row(int y)
+{
+    return pixels + (size_t)y * width;
+}
+
+/* PNG 流式写出: 8 位灰度, 不压缩. IDAT 中的 zlib 数据由 deflate 的存储块组成,
+   总长度事先就能算出来, 所以整幅图只需要一个 IDAT 块, 逐行直接从帧缓冲写出,
+   同时累加 CRC32 和 Adler32, 不需要先在内存中拼出整个文件 */
+class PngStream {
+    std::ostream* out;
+    unsigned long crc;
+    unsigned long adler_a, adler_b;
+    unsigned long block_left;
+    unsigned long data_left;
+
+    static unsigned long crc_table[256];
+    static void make_crc_table();
+
+public:
+    PngStream(std::ostream&);
+    void begin_chunk(const char*, unsigned long);
+    void put(const unsigned char*, unsigned long);
+    void put_u32(unsigned long);
+    void end_chunk();
+    void begin_zlib(unsigned long);
+    void put_data(const unsigned char*, unsigned long);
+    void end_zlib();
+    static unsigned long zlib_size(unsigned long);
+};
+
+///< 坐标四舍五入到像素
+inline int to_pixel(double v)
+{
+    return (int)std::floor(v + 0.5);
+}
+
+///< 一条线段绘制命令
+struct LineSegment {
+    double x1, y1, x2, y2;
+};
+
+/* drawLines 一次虚调用处理一整批线段. 默认实现逐条转给 drawLine, 只实现了 drawLine 的
+   外部实现(插件)照样可用; 内置实现都重写了它, 在一个循环里直接光栅化整批线段 */
+class Drawing {
+public:
+    virtual ~Drawing();
+    virtual void drawLine(double x1, double y1, double x2, double y2) = 0;
+    virtual void drawLines(const LineSegment* lines, int num);
+};
+
+/* 命令缓冲: 形状把线段追加到这里, 攒满 limit 条(最多 batch_len 条)后一次提交给目标实现.
+   存储是定长数组, 放在栈上即可, 绘制过程中不分配内存. 析构时提交剩余的命令 */
+class DrawCommandBuffer {
+    LineSegment commands[batch_len];
+    int command_num;
+    int limit;
+    Drawing* target;
+
+    DrawCommandBuffer(const DrawCommandBuffer&);
+    DrawCommandBuffer& operator=(const DrawCommandBuffer&);
+
+public:
+    DrawCommandBuffer(Drawing*, int = batch_len);
+    ~DrawCommandBuffer();
+    void retarget(Drawing*);
+    void add_line(double x1, double y1, double x2, double y2);
+    void flush();
+};
+
+/* 两种内置实现的公共部分: 目标帧缓冲和裁剪区域, 以及把 drawLine / drawLines 转给子类的 line.
+   子类把自己作为模板参数传进来, 批量接口在循环里直接调用非虚的 Impl::line,
+   编译器可以把光栅化内联进循环. 两种实现只在 line 上不同.
+   裁剪区域默认是整个帧缓冲, 分块渲染时每块各用一个只写自己区域的实现对象 */
+template <class Impl>
+class ClippedDrawing : public Drawing {
+public:
+    ClippedDrawing(Framebuffer&);
+    void set_clip(int, int, int, int);
+    void drawLine(double x1, double y1, double x2, double y2);
+    void drawLines(const LineSegment* lines, int num);
+protected:
+    int outside_clip(int, int, int, int);
+    int clip_walk(int&, int&, int&, int, int);
+
+    Framebuffer* fb;
+    int clip_x0, clip_y0, clip_x1, clip_y1;
+};
+
+template <class Impl>
+ClippedDrawing<Impl>::ClippedDrawing(Framebuffer& f)
+{
+    fb = &f;
+    set_clip(0, 0, f.get_width(), f.get_height());
+}
+
+///< 裁剪区域为 [x0, x1) x [y0, y1), 与帧缓冲取交集
+template <class Impl>
+void ClippedDrawing<Impl>::set_clip(int x0, int y0, int x1, int y1)
+{
+    clip_x0 = x0 > 0 ? x0 : 0;
+    clip_y0 = y0 > 0 ? y0 : 0;
+    clip_x1 = x1 < fb->get_width() ? x1 : fb->get_width();
+    clip_y1 = y1 < fb->get_height() ? y1 : fb->get_height();
+}
+
+template <class Impl>
+void ClippedDrawing<Impl>::drawLine(double x1, double y1, double x2, double y2)
+{
+    static_cast<Impl*>(this)->line(x1, y1, x2, y2);
+}
+
+template <class Impl>
+void ClippedDrawing<Impl>::drawLines(const LineSegment* lines, int num)
+{
+    Impl* impl = static_cast<Impl*>(this);
+    int i;
+
+    for (i = 0; i < num; ++i) {
+        impl->line(lines[i].x1, lines[i].y1, lines[i].x2, lines[i].y2);
+    }
+}
+
+///< 线段两端都在裁剪区域同一侧时整条线段都不可见, 不必逐点走一遍
+template <class Impl>
+int ClippedDrawing<Impl>::outside_clip(int x0, int y0, int xe, int ye)
+{
+    return ((x0 < clip_x0 && xe < clip_x0) || (x0 >= clip_x1 && xe >= clip_x1) ||
+        (y0 < clip_y0 && ye < clip_y0) || (y0 >= clip_y1 && ye >= clip_y1));
+}
+
+/* 把 Bresenham 直接推进到线段上第一个落在裁剪区域内的像素. x0, y0 是起点, err 是初始误差项,
+   返回时它们是推进之后的状态; 返回值是从那里起还要走的步数, 线段与裁剪区域不相交时返回 -1.
+   主方向(dx, dy 中较大的一个)每步都走, 走了 k 步时次方向恰好走了
+   (2 * k * minor + major) / (2 * major) 步, 所以推进后的坐标和误差项可以直接算出来,
+   之后走出的像素与从起点一步步走过来完全相同. 穿过裁剪区域的长线段只走区域内的那一段 */
+template <class Impl>
+int ClippedDrawing<Impl>::clip_walk(int& x0, int& y0, int& err, int xe, int ye)
+{
+    long long dx = xe > x0 ? xe - x0 : x0 - xe, dy = ye > y0 ? ye - y0 : y0 - ye;
+    long long xlo = x0 < xe ? clip_x0 - x0 : x0 - (clip_x1 - 1);
+    long long xhi = x0 < xe ? clip_x1 - 1 - x0 : x0 - clip_x0;
+    long long ylo = y0 < ye ? clip_y0 - y0 : y0 - (clip_y1 - 1);
+    long long yhi = y0 < ye ? clip_y1 - 1 - y0 : y0 - clip_y0;
+    long long major, minor, klo, khi, jlo, jhi, k, j;
+    int x_major = dx >= dy;
+
+    ///< 主方向和次方向上各自落在裁剪区域内的步数范围
+    major = x_major ? dx : dy;
+    minor = x_major ? dy : dx;
+    klo = x_major ? xlo : ylo;
+    khi = x_major ? xhi : yhi;
+    jlo = x_major ? ylo : xlo;
+    jhi = x_major ? yhi : xhi;
+    if (klo < 0) {
+        klo = 0;
+    }
+    if (khi > major) {
+        khi = major;
+    }
+    if (jlo < 0) {
+        jlo = 0;
+    }
+    if (jhi > minor) {
+        jhi = minor;
+    }
+    if (jlo > jhi) {
+        return -1;
+    }
+    ///< 次方向的范围换算成主方向的步数: 次方向步数随 k 单调不减
+    if (minor > 0) {
+        if (jlo > 0) {
+            k = ((2 * jlo - 1) * major + 2 * minor - 1) / (2 * minor);
+            if (k > klo) {
+                klo = k;
+            }
+        }
+        k = ((2 * jhi + 1) * major + 2 * minor - 1) / (2 * minor) - 1;
+        if (k < khi) {
+            khi = k;
+        }
+    }
+    if (klo > khi) {
+        return -1;
+    }
+
+    j = minor ? (2 * klo * minor + major) / (2 * major) : 0;
+    if (x_major) {
+        x0 += (int)(x0 < xe ? klo : -klo);
+        y0 += (int)(y0 < ye ? j : -j);
+        err = (int)(dx - dy - klo * dy + j * dx);
+    } else {
+        y0 += (int)(y0 < ye ? klo : -klo);
+        x0 += (int)(x0 < xe ? j : -j);
+        err = (int)(dx - dy + klo * dx - j * dy);
+    }
+    return (int)(khi - klo);
+}
+
+///< 第一种实现: 标量的 Bresenham 算法, 逐个像素判断是否在裁剪区域内并写入
+class V1Drawing : public ClippedDrawing<V1Drawing> {
+public:
+    V1Drawing(Framebuffer&);
+    void line(double, double, double, double);
+};
+
+/* 第二种实现: 按水平跨度填充. 走的是与 V1Drawing 相同的 Bresenham 路径, 所以画出的像素完全一样,
+   但同一行上连续的像素攒成一个跨度, 裁剪一次后整段填充; 水平线和竖直线直接走快速路径 */
+class V2Drawing : public ClippedDrawing<V2Drawing> {
+public:
+    V2Drawing(Framebuffer&);
+    void line(double, double, double, double);
+private:
+    void fill_span(int, int, int);
+};
+
+/* 两种实现的 line 和 fill_span 定义在头文件中: 静态桥接的 StaticScene<Impl>::draw 在使用者的
+   翻译单元中实例化, 只有看得到定义, 编译器才能把光栅化内联进绘制循环 */
+BRIDGE_INLINE void V1Drawing::line(double x1, double y1, double x2, double y2)
+{
+    int x0 = to_pixel(x1), y0 = to_pixel(y1), xe = to_pixel(x2), ye = to_pixel(y2);
+    int dx = std::abs(xe - x0), dy = -std::abs(ye - y0);
+    int sx = x0 < xe ? 1 : -1, sy = y0 < ye ? 1 : -1;
+    int err = dx + dy, e2, n;
+
+    if (outside_clip(x0, y0, xe, ye)) {
+        return;
+    }
+    n = clip_walk(x0, y0, err, xe, ye);
+    if (n < 0) {
+        return;
+    }
+
+    for (;;) {
+        if (x0 >= clip_x0 && x0 < clip_x1 && y0 >= clip_y0 && y0 < clip_y1) {
+            fb->row(y0)[x0] = ink;
+        }
+        if (n-- == 0) {
+            break;
+        }
+        e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+///< 在第 y 行填充 [xa, xb] 之间的像素, 端点顺序任意, 超出裁剪区域的部分被裁掉
+inline void V2Drawing::fill_span(int y, int xa, int xb)
+{
+    unsigned char* p;
+    int n;
+
+    if (y < clip_y0 || y >= clip_y1) {
+        return;
+    }
+    if (xa > xb) {
+        n = xa;
+        xa = xb;
+        xb = n;
+    }
+    if (xa < clip_x0) {
+        xa = clip_x0;
+    }
+    if (xb >= clip_x1) {
+        xb = clip_x1 - 1;
+    }
+    if (xa > xb) {
+        return;
+    }
+
+    p = fb->row(y) + xa;
+    n = xb - xa + 1;
+#ifdef BRIDGE_SSE2
+    const __m128i v = _mm_set1_epi8((char)ink);
+    while (n >= 16) {
+        _mm_storeu_si128((__m128i*)p, v);
+        p += 16;
+        n -= 16;
+    }
+#endif
+    while (n-- > 0) {
+        *p++ = ink;
+    }
+}
+
+BRIDGE_INLINE void V2Drawing::line(double x1, double y1, double x2, double y2)
+{
+    int x0 = to_pixel(x1), y0 = to_pixel(y1), xe = to_pixel(x2), ye = to_pixel(y2);
+    int dx = std::abs(xe - x0), dy = -std::abs(ye - y0);
+    int sx = x0 < xe ? 1 : -1, sy = y0 < ye ? 1 : -1;
+    int err = dx + dy, e2, span_start, ya, yb, x, n;
+
+    if (outside_clip(x0, y0, xe, ye)) {
+        return;
+    }
+
+    if (dy == 0) {
+        fill_span(y0, x0, xe);
+        return;
+    }
+    if (dx == 0) {
+        if (x0 < clip_x0 || x0 >= clip_x1) {
+            return;
+        }
+        ya = y0 < ye ? y0 : ye;
+        yb = y0 < ye ? ye : y0;
+        if (ya < clip_y0) {
+            ya = clip_y0;
+        }
+        for (; ya <= yb && ya < clip_y1; ++ya) {
+            fb->row(ya)[x0] = ink;
+        }
+        return;
+    }
+
+    n = clip_walk(x0, y0, err, xe, ye);
+    if (n < 0) {
+        return;
+    }
+    span_start = x0;
+    for (;;) {
+        if (n-- == 0) {
+            fill_span(y0, span_start, x0);
+            break;
+        }
+        e2 = 2 * err;
+        x = x0;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            fill_span(y0, span_start, x);
+            y0 += sy;
+            span_start = x0;
+        }
+    }
+}
+
+///< 轴对齐包围盒, x0 <= x1, y0 <= y1
+struct BoundingBox {
+    double x0, y0, x1, y1;
+};
+
+/* 形状只知道抽象的 Drawing, 具体画到哪里由构造时传入的实现决定.
+   子类通过 emit 把自己的线段追加到命令缓冲, 由缓冲成批地交给实现 */
+class Shape{
+public:
+    Shape(Drawing *dp);
+    virtual ~Shape();
+    virtual void draw();
+    void draw(DrawCommandBuffer& batch);
+    virtual void emit(DrawCommandBuffer& batch) = 0;
+    virtual BoundingBox bounds() = 0;
+private:
+    Drawing *_dp;
+};
+
+/* 形状的几何只写一份: 下面两个模板把线段交给任何带 add_line 的接收者,
+   动态桥接传入 DrawCommandBuffer, 静态桥接传入直接调用实现的 DirectLines */
+template <class Sink>
+void emit_rectangle(Sink& sink, double x1, double y1, double x2, double y2)
+{
+    sink.add_line(x1, y1, x2, y1);
+    sink.add_line(x2, y1, x2, y2);
+    sink.add_line(x2, y2, x1, y2);
+    sink.add_line(x1, y2, x1, y1);
+}
+
+/* 顶点用旋转递推求出, 每条边只做乘加, 不调用 sin/cos; 最后一条边回到起点, 保证闭合 */
+template <class Sink>
+void emit_circle(Sink& sink, double x, double y, double r, int segments)
+{
+    double c = std::cos(2 * pi / segments), s = std::sin(2 * pi / segments);
+    double px = r, py = 0, nx, ny;
+    int i;
+
+    for (i = 1; i < segments; ++i) {
+        nx = px * c - py * s;
+        ny = px * s + py * c;
+        sink.add_line(x + px, y + py, x + nx, y + ny);
+        px = nx;
+        py = ny;
+    }
+    sink.add_line(x + px, y + py, x + r, y);
+}
+
+///< 圆的边数: 每条边大约两个像素长, 限制在 [min_circle_segments, max_circle_segments]
+int circle_segments(double r);
+
+///< 矩形由两个对角点确定, 画四条边
+class Rectangle : public Shape {
+public:
+    Rectangle(Drawing *dp, double x1, double y1, double x2, double y2);
+    void emit(DrawCommandBuffer& batch);
+    BoundingBox bounds();
+private:
+    double _x1, _y1, _x2, _y2;
+};
+
+///< 圆用内接多边形近似
+
+class Circle : public Shape {
+public:
+    Circle(Drawing *dp, double x, double y, double r);
+    void emit(DrawCommandBuffer& batch);
+    BoundingBox bounds();
+private:
+    double _x, _y, _r;
+    int _segments;
+};
+
+/* 静态桥接: 同样是 "形状 + 实现" 两个维度, 但实现类作为模板参数在编译期确定,
+   形状按值连续存放在 vector 中, 用 kind 区分种类. 绘制时没有任何虚调用,
+   编译器可以把光栅化内联进循环. 需要运行期替换实现(插件)时仍然使用上面的动态桥接 */
+enum ShapeKind { rectangle_kind, circle_kind };
+
+struct RectangleGeometry {
+    double x1, y1, x2, y2;
+};
+
+struct CircleGeometry {
+    double x, y, r;
+    int segments;
+};
+
+struct ShapeRecord {
+    ShapeKind kind;
+    union {
+        RectangleGeometry rect;
+        CircleGeometry circle;
+    } u;
+};
+
+ShapeRecord make_rectangle(double x1, double y1, double x2, double y2);
+
+ShapeRecord make_circle(double x, double y, double r);
+
+///< 根据记录构造动态桥接中对应的形状对象, 两种桥接可以画同一个场景
+Shape* make_shape(Drawing* dp, const ShapeRecord& rec);
+
+///< 把线段直接交给具体实现的非虚 line 方法
+template <class Impl>
+class DirectLines {
+public:
+    DirectLines(Impl& impl);
+    void add_line(double x1, double y1, double x2, double y2);
+private:
+    Impl* _impl;
+};
+
+template <class Impl>
+DirectLines<Impl>::DirectLines(Impl& impl)
+{
+    _impl = &impl;
+}
+
+template <class Impl>
+BRIDGE_INLINE void DirectLines<Impl>::add_line(double x1, double y1, double x2, double y2)
+{
+    _impl->line(x1, y1, x2, y2);
+}
+
+template <class Impl>
+class StaticScene {
+public:
+    StaticScene(Impl& impl);
+    void add(const ShapeRecord& rec);
+    void draw();
+private:
+    Impl* _impl;
+    std::vector<ShapeRecord> _shapes;
+};
+
+template <class Impl>
+StaticScene<Impl>::StaticScene(Impl& impl)
+{
+    _impl = &impl;
+}
+
+template <class Impl>
+void StaticScene<Impl>::add(const ShapeRecord& rec)
+{
+    _shapes.push_back(rec);
+}
+
+template <class Impl>
+void StaticScene<Impl>::draw()
+{
+    DirectLines<Impl> lines(*_impl);
+    const ShapeRecord* rec = _shapes.empty() ? NULL : &_shapes[0];
+    const ShapeRecord* end = rec + _shapes.size();
+
+    for (; rec != end; ++rec) {
+        switch (rec->kind) {
+        case rectangle_kind:
+            emit_rectangle(lines, rec->u.rect.x1, rec->u.rect.y1, rec->u.rect.x2, rec->u.rect.y2);
+            break;
+        case circle_kind:
+            emit_circle(lines, rec->u.circle.x, rec->u.circle.y, rec->u.circle.r, rec->u.circle.segments);
+            break;
+        }
+    }
+}
+
+///< 记录用的实现: 不画任何东西, 只把收到的线段追加到 vector 中
+class RecordingDrawing : public Drawing {
+    std::vector<LineSegment>* out;
+
+public:
+    RecordingDrawing(std::vector<LineSegment>&);
+    void drawLine(double x1, double y1, double x2, double y2);
+    void drawLines(const LineSegment* lines, int num);
+};
+
+///< 线程池执行的任务, run 的参数是任务编号
+class TileJob {
+public:
+    virtual ~TileJob();
+    virtual void run(int) = 0;
+};
+
+/* 常驻的线程池: 每次 run 唤醒工作线程一次, 任务编号通过原子计数器领取, 执行任务时不持有锁.
+   调用 run 的线程也参与执行, 所有工作线程都报到完毕后 run 才返回 */
+class ThreadPool {
+    std::thread* threads;
+    int thread_num;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    unsigned int generation;
+    int stopping;
+    TileJob* job;
+    int job_num;
+    std::atomic<int> next;
+    std::atomic<int> remaining;
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+    void worker_main();
+    void execute();
+
+public:
+    ThreadPool(int);
+    ~ThreadPool();
+    int get_thread_num();
+    void run(TileJob&, int);
+};
+
+/* 场景拥有一组形状. 渲染前先让每个形状把线段记录下来(形状不变时只记录一次),
+   按每条线段的包围盒把线段分到 tile_len x tile_len 的屏幕块中, 然后各块并行渲染:
+   每块用一个裁剪到本块的实现对象, 只写自己那一块帧缓冲, 因此块之间不需要任何同步.
+   跨多个块的线段会在每个块里各画一次, 但实现先把线段裁剪到本块再光栅化,
+   只走本块内的像素, 所以分块之后的总工作量与直接绘制相差不多.
+   形状和帧缓冲尺寸都不变时, 记录和分块的结果留给下一帧直接使用.
+   每块的实现对象由 render 的模板参数 Impl 决定, 所以场景接收的是形状描述而不是已经
+   桥接到某个实现上的 Shape: 场景内部的形状不绑定任何 Drawing, 整个场景用哪个实现由调用者选择 */
+class Scene {
+public:
+    Scene();
+    ~Scene();
+    void add(const ShapeRecord& rec);
+    int get_shape_num();
+    template <class Impl>
+    void render(Framebuffer& fb, ThreadPool& pool);
+    void draw_tile(Drawing& dp, int tile);
+    void tile_rect(int tile, int& x0, int& y0, int& x1, int& y1);
+private:
+    void record();
+    void bin(int width, int height);
+
+    std::vector<Shape*> _shapes;
+    std::vector<LineSegment> _segments;
+    std::vector<int> _bounds;
+    std::vector<int> _tile_first;
+    std::vector<int> _tile_lines;
+    int _recorded;
+    int _binned_width, _binned_height;
+    int _tiles_x, _tiles_y;
+};
+
+///< 每块的渲染任务: 在栈上构造一个裁剪到本块的实现对象
+template <class Impl>
+class TileRenderJob : public TileJob {
+public:
+    TileRenderJob(Scene& scene, Framebuffer& fb);
+    void run(int tile);
+private:
+    Scene* _scene;
+    Framebuffer* _fb;
+};
+
+template <class Impl>
+TileRenderJob<Impl>::TileRenderJob(Scene& scene, Framebuffer& fb)
+{
+    _scene = &scene;
+    _fb = &fb;
+}
+
+template <class Impl>
+void TileRenderJob<Impl>::run(int tile)
+{
+    Impl dp(*_fb);
+    int x0, y0, x1, y1;
+
+    _scene->tile_rect(tile, x0, y0, x1, y1);
+    dp.set_clip(x0, y0, x1, y1);
+    _scene->draw_tile(dp, tile);
+}
+
+template <class Impl>
+void Scene::render(Framebuffer& fb, ThreadPool& pool)
+{
+    TileRenderJob<Impl> job(*this, fb);
+
+    if (!_recorded) {
+        record();
+    }
+    if (_binned_width != fb.get_width() || _binned_height != fb.get_height()) {
+        bin(fb.get_width(), fb.get_height());
+    }
+    pool.run(job, _tiles_x * _tiles_y);
+}
+
+/* 形状的空间索引: 批量构建的均匀网格. 网格覆盖所有包围盒的并集, 格子边长不小于
+   sqrt(面积 / 形状数) 和 (较长边 / 形状数), 所以格子总数不超过 3 * 形状数 + 1,
+   细长的场景也能做到每个格子大约一个形状. 格子边长也不小于包围盒的平均边长, 免得一个形状登记在太多格子里.
+   每个形状登记在它的包围盒覆盖的所有格子中, 用与 Scene::bin 相同的两遍计数排序
+   存成压缩数组. 查询只访问与查询区域相交的格子, 对分布比较均匀的场景,
+   点查询的代价与形状总数无关. 包围盒另外连续存放一份, 查询时不必访问形状对象.
+   建好之后索引是只读的, 可以被多个线程同时查询 */
+class ShapeIndex {
+public:
+    ShapeIndex(Shape* const* shapes, int num);
+    int query_point(double x, double y, std::vector<int>& out) const;
+    int query_rect(const BoundingBox& view, std::vector<int>& out) const;
+    int get_cell_num() const;
+private:
+    int cell_x(double x) const;
+    int cell_y(double y) const;
+
+    std::vector<BoundingBox> _boxes;
+    std::vector<int> _cell_first;
+    std::vector<int> _cell_items;
+    BoundingBox _world;
+    double _inv_cell;
+    int _cells_x, _cells_y;
+};
+
+/* 与各平台 rand() 无关的线性同余序列, 返回 [0, n) 中的一个数, 同一个种子总是得到同一串结果.
+   模 2 的幂的线性同余序列中, 低 k 位的周期只有 2^k, 直接对状态取模会让结果很快重复,
+   所以每步只取状态的高 15 位, 两步拼成 30 位之后再取模. 基准场景, 索引查询和 4.3节 的负载都用它 */
+int next_index(unsigned long& seed, int n);
+
+/* 基准场景: 形状由固定种子的 next_index 序列生成, 不依赖各平台 rand() 的实现,
+   这样同一个场景在任何平台上都画出相同的像素, 才能与仓库中的基准图像比较 */
+enum SuiteScene { rects_scene, circles_scene, mixed_scene };
+
+void make_suite_scene(int scene, int count, int width, int height, std::vector<ShapeRecord>& recs);
+
+#endif
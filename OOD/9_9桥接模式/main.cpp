@@ -1,44 +1,445 @@
-///< 实现Bridget模式
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <thread>
 
-class Drawing {
-public: 
-    virtual void drawLine(double x1, double y1, double x2, double y2) = 0;
-};
+#include "bridge.h"
+
+///< 输出一行计时结果
+void report(const char* name, const char* how, int shape_num, long long us)
+{
+    std::cout << name << ", " << how << ": " << shape_num << " shapes in " << us / 1000.0 << " ms, ";
+    std::cout << (us ? shape_num * 1000000.0 / us : 0.0) << " shapes/sec\n";
+}
+
+/* 动态桥接: 批大小为 1 时每条线段一次虚调用, 相当于逐条 drawLine; 另一次按 batch_len 成批提交.
+   形状本身的 draw 也是虚调用, 所以这里测的就是形状 + 抽象 + 实现的整体开销 */
+void time_dynamic(const char* name, Drawing& dp, Framebuffer& fb, const std::vector<ShapeRecord>& recs)
+{
+    int shape_num = (int)recs.size(), i, k, batch;
+    Shape** shapes = new Shape*[shape_num];
+    long long us;
+
+    for (i = 0; i < shape_num; ++i) {
+        shapes[i] = make_shape(&dp, recs[i]);
+    }
+    for (k = 0; k < 2; ++k) {
+        batch = k ? batch_len : 1;
+        fb.clear();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        {
+            DrawCommandBuffer commands(&dp, batch);
+            for (i = 0; i < shape_num; ++i) {
+                shapes[i]->draw(commands);
+            }
+        }
+        us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        report(name, batch == 1 ? "virtual, batch 1" : "virtual, batched", shape_num, us);
+    }
+    for (i = 0; i < shape_num; ++i) {
+        delete shapes[i];
+    }
+    delete [] shapes;
+}
+
+///< 静态桥接: 同一组形状, 没有虚调用
+template <class Impl>
+void time_static(const char* name, Impl& impl, Framebuffer& fb, const std::vector<ShapeRecord>& recs)
+{
+    StaticScene<Impl> scene(impl);
+    long long us;
+    int i;
+
+    for (i = 0; i < (int)recs.size(); ++i) {
+        scene.add(recs[i]);
+    }
+    fb.clear();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    scene.draw();
+    us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    report(name, "static", (int)recs.size(), us);
+}
+
+/* 用同一组随机形状分别驱动两种实现和两种桥接, 比较速度并确认画出的像素完全相同 */
+int run_benchmark(int shape_num, int width, int height)
+{
+    Framebuffer fb1(width, height), fb2(width, height), fb3(width, height), fb4(width, height);
+    V1Drawing dp1(fb1), sp1(fb3);
+    V2Drawing dp2(fb2), sp2(fb4);
+    std::vector<ShapeRecord> recs;
+    double x, y, sz;
+    int i;
+
+    srand(1);
+    recs.reserve(shape_num);
+    for (i = 0; i < shape_num; ++i) {
+        x = rand() % width;
+        y = rand() % height;
+        sz = 2 + rand() % 64;
+        if (i % 2) {
+            recs.push_back(make_circle(x, y, sz / 2));
+        } else {
+            recs.push_back(make_rectangle(x, y, x + sz, y + sz * 0.75));
+        }
+    }
+
+    time_dynamic("V1Drawing (scalar Bresenham)", dp1, fb1, recs);
+    time_static("V1Drawing (scalar Bresenham)", sp1, fb3, recs);
+    time_dynamic("V2Drawing (span fill)", dp2, fb2, recs);
+    time_static("V2Drawing (span fill)", sp2, fb4, recs);
+
+    if (!fb1.same_as(fb2) || !fb1.same_as(fb3) || !fb1.same_as(fb4)) {
+        std::cout << "Error: the drawings produced different pixels.\n";
+        return 1;
+    }
+    std::cout << "All drawings produced identical pixels.\n";
+    return 0;
+}
+
+/* 分块并行渲染: 先用单线程直接绘制作为参照, 再用 1 个线程和 thread_num 个线程分别渲染场景,
+   比较耗时并确认三者像素相同 */
+int run_scene(int shape_num, int width, int height, int thread_num)
+{
+    Framebuffer reference(width, height), fb1(width, height), fbn(width, height);
+    V2Drawing direct(reference);
+    Scene scene;
+    ThreadPool single(1), pool(thread_num);
+    ShapeRecord rec;
+    Shape* shape;
+    double x, y, sz;
+    long long us1, usn;
+    int i;
+
+    srand(1);
+    for (i = 0; i < shape_num; ++i) {
+        x = rand() % width;
+        y = rand() % height;
+        sz = 2 + rand() % 64;
+        if (i % 2) {
+            rec = make_circle(x, y, sz / 2);
+        } else {
+            rec = make_rectangle(x, y, x + sz, y + sz * 0.75);
+        }
+        shape = make_shape(&direct, rec);
+        shape->draw();
+        delete shape;
+        scene.add(rec);
+    }
+
+    ///< 第一次渲染包含记录线段的开销, 计时用第二次
+    scene.render<V2Drawing>(fb1, single);
+    fb1.clear();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    scene.render<V2Drawing>(fb1, single);
+    us1 = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    scene.render<V2Drawing>(fbn, pool);
+    usn = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    report("Scene, 1 thread", "tiled", shape_num, us1);
+    std::cout << "Scene, " << pool.get_thread_num() << " threads, tiled: " << shape_num << " shapes in ";
+    std::cout << usn / 1000.0 << " ms, speedup " << (usn ? (double)us1 / usn : 0.0) << "x\n";
+
+    if (!reference.same_as(fb1) || !reference.same_as(fbn)) {
+        std::cout << "Error: the tiled render differs from direct drawing.\n";
+        return 1;
+    }
+    std::cout << "Tiled renders match direct drawing.\n";
+    return 0;
+}
 
-class Shape{
+///< 基准图像的名字和尺寸
+const char* suite_names[3] = { "rects", "circles", "mixed" };
+const int golden_width = 256;
+const int golden_height = 192;
+const int golden_shapes = 300;
+
+/* 用各条渲染路径画同一个场景: 0 动态 V1, 1 动态 V2, 2 静态 V2, 3 分块并行 V2.
+   形状对象, 命令缓冲和场景都在构造时建好, 场景的线段也先记录一次, draw 只做绘制,
+   这样各条路径的计时只包含光栅化本身, 彼此可以比较. draw 不清空帧缓冲 */
+const int suite_paths = 4;
+const char* suite_path_names[suite_paths] = { "virtual V1", "virtual V2", "static V2", "tiled V2" };
+
+class SuiteRenderer {
 public:
-    Shape(Drawing *dp);
-    virtual void draw() = 0;
+    SuiteRenderer(const std::vector<ShapeRecord>& recs, Framebuffer& fb, ThreadPool& pool);
+    ~SuiteRenderer();
+    void draw(int path);
 private:
-    Drawing *_dp;
+    SuiteRenderer(const SuiteRenderer&);
+    SuiteRenderer& operator=(const SuiteRenderer&);
+
+    Framebuffer* _fb;
+    ThreadPool* _pool;
+    V1Drawing _dp1;
+    V2Drawing _dp2;
+    DrawCommandBuffer _commands1;
+    DrawCommandBuffer _commands2;
+    std::vector<Shape*> _shapes1;
+    std::vector<Shape*> _shapes2;
+    StaticScene<V2Drawing> _static_scene;
+    Scene _scene;
 };
 
-Shape::Shape(Drawing *dp) 
+SuiteRenderer::SuiteRenderer(const std::vector<ShapeRecord>& recs, Framebuffer& fb, ThreadPool& pool)
+    : _dp1(fb), _dp2(fb), _commands1(&_dp1), _commands2(&_dp2), _static_scene(_dp2)
 {
-    _dp = dp;
+    int i;
+
+    _fb = &fb;
+    _pool = &pool;
+    for (i = 0; i < (int)recs.size(); ++i) {
+        _shapes1.push_back(make_shape(&_dp1, recs[i]));
+        _shapes2.push_back(make_shape(&_dp2, recs[i]));
+        _static_scene.add(recs[i]);
+        _scene.add(recs[i]);
+    }
+    ///< 第一次渲染记录线段, 之后的渲染只做分块和光栅化
+    _scene.render<V2Drawing>(fb, pool);
 }
 
+SuiteRenderer::~SuiteRenderer()
+{
+    int i;
+    for (i = 0; i < (int)_shapes1.size(); ++i) {
+        delete _shapes1[i];
+        delete _shapes2[i];
+    }
+}
 
+/* 命令缓冲会拷贝线段, 所以整个场景只在最后 flush 一次, 中间按 batch_len 成批提交 */
+void SuiteRenderer::draw(int path)
+{
+    std::vector<Shape*>& shapes = path == 0 ? _shapes1 : _shapes2;
+    DrawCommandBuffer& commands = path == 0 ? _commands1 : _commands2;
+    int i;
 
+    if (path == 2) {
+        _static_scene.draw();
+    } else if (path == 3) {
+        _scene.render<V2Drawing>(*_fb, *_pool);
+    } else {
+        for (i = 0; i < (int)shapes.size(); ++i) {
+            shapes[i]->draw(commands);
+        }
+        commands.flush();
+    }
+}
+
+/* 基准测试套件: 每个场景先在 golden_width x golden_height 上用所有渲染路径作图并与
+   golden 目录中的基准图像比较(update 时改为重写基准图像), 给出 png_dir 时再往该目录写一张 PNG 便于查看;
+   然后在 width x height 上画 shape_num 个形状, 记录每条路径的 shapes/sec, 只计绘制时间 */
+int run_suite(const char* golden_dir, int update, const char* png_dir, int shape_num, int width, int height)
+{
+    Framebuffer small(golden_width, golden_height), golden(golden_width, golden_height);
+    Framebuffer large(width, height);
+    ThreadPool pool((int)std::thread::hardware_concurrency());
+    std::vector<ShapeRecord> recs;
+    std::string path;
+    long long us;
+    int scene, p, failures = 0;
 
+    for (scene = 0; scene < 3; ++scene) {
+        path = std::string(golden_dir) + "/" + suite_names[scene] + ".pgm";
+        make_suite_scene(scene, golden_shapes, golden_width, golden_height, recs);
+        SuiteRenderer checks(recs, small, pool);
+        if (update) {
+            small.clear();
+            checks.draw(1);
+            std::ofstream out(path.c_str(), std::ios::binary);
+            if (!small.write_pgm(out)) {
+                std::cout << "Error: cannot write " << path << ".\n";
+                return 1;
+            }
+            std::cout << "Updated " << path << "\n";
+        } else {
+            std::ifstream in(path.c_str(), std::ios::binary);
+            if (!golden.read_pgm(in)) {
+                std::cout << "Error: cannot read golden image " << path << ".\n";
+                return 1;
+            }
+        }
+        for (p = 0; p < suite_paths; ++p) {
+            small.clear();
+            checks.draw(p);
+            if (!update && !small.same_as(golden)) {
+                std::cout << "FAIL " << suite_names[scene] << " (" << suite_path_names[p] << ")\n";
+                ++failures;
+            }
+        }
+        if (png_dir != NULL) {
+            path = std::string(png_dir) + "/" + suite_names[scene] + ".png";
+            std::ofstream png(path.c_str(), std::ios::binary);
+            if (!small.write_png(png)) {
+                std::cout << "Error: cannot write " << path << ".\n";
+                return 1;
+            }
+        }
+
+        make_suite_scene(scene, shape_num, width, height, recs);
+        SuiteRenderer timed(recs, large, pool);
+        for (p = 0; p < suite_paths; ++p) {
+            large.clear();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            timed.draw(p);
+            us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            report(suite_names[scene], suite_path_names[p], shape_num, us);
+        }
+    }
+
+    if (failures) {
+        std::cout << failures << " golden image comparisons failed.\n";
+        return 1;
+    }
+    if (!update) {
+        std::cout << "All renders match the golden images.\n";
+    }
+    return 0;
+}
 
-void main() 
+/* 空间索引测试: 为 shape_num 个形状建立索引, 做 query_num 次点查询和视口查询并计时,
+   再对其中一部分查询用逐个比较的方法核对结果 */
+int run_index(int shape_num, int width, int height, int query_num)
 {
+    std::vector<ShapeRecord> recs;
+    std::vector<Shape*> shapes;
+    std::vector<int> hits;
+    std::vector<double> qx, qy;
+    BoundingBox view, b;
+    long long build_us, point_us, rect_us;
+    long long point_hits = 0, rect_hits = 0;
+    int i, j, brute, errors = 0;
+    unsigned long seed = 99;
+
+    make_suite_scene(mixed_scene, shape_num, width, height, recs);
+    for (i = 0; i < shape_num; ++i) {
+        shapes.push_back(make_shape(NULL, recs[i]));
+    }
+    for (i = 0; i < query_num; ++i) {
+        qx.push_back((double)next_index(seed, width));
+        qy.push_back((double)next_index(seed, height));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ShapeIndex index(shape_num ? &shapes[0] : NULL, shape_num);
+    build_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < query_num; ++i) {
+        point_hits += index.query_point(qx[i], qy[i], hits);
+    }
+    point_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < query_num; ++i) {
+        view.x0 = qx[i];
+        view.y0 = qy[i];
+        view.x1 = qx[i] + 320;
+        view.y1 = qy[i] + 240;
+        rect_hits += index.query_rect(view, hits);
+    }
+    rect_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Index of " << shape_num << " shapes (" << index.get_cell_num() << " cells) built in ";
+    std::cout << build_us / 1000.0 << " ms\n";
+    std::cout << query_num << " point queries in " << point_us / 1000.0 << " ms, ";
+    std::cout << point_hits << " hits\n";
+    std::cout << query_num << " 320x240 view queries in " << rect_us / 1000.0 << " ms, ";
+    std::cout << rect_hits << " hits\n";
+
+    for (i = 0; i < query_num && i < 20; ++i) {
+        view.x0 = qx[i];
+        view.y0 = qy[i];
+        view.x1 = qx[i] + 320;
+        view.y1 = qy[i] + 240;
+        brute = 0;
+        for (j = 0; j < shape_num; ++j) {
+            b = shapes[j]->bounds();
+            brute += !(b.x1 < view.x0 || b.x0 > view.x1 || b.y1 < view.y0 || b.y0 > view.y1);
+        }
+        errors += brute != index.query_rect(view, hits);
+        brute = 0;
+        for (j = 0; j < shape_num; ++j) {
+            b = shapes[j]->bounds();
+            brute += qx[i] >= b.x0 && qx[i] <= b.x1 && qy[i] >= b.y0 && qy[i] <= b.y1;
+        }
+        errors += brute != index.query_point(qx[i], qy[i], hits);
+    }
+    for (i = 0; i < shape_num; ++i) {
+        delete shapes[i];
+    }
+    if (errors) {
+        std::cout << "Error: " << errors << " queries disagree with a linear scan.\n";
+        return 1;
+    }
+    std::cout << "Sampled queries match a linear scan.\n";
+    return 0;
+}
+
+/* 带参数 bench 启动时比较两种实现: bench [形状数] [宽] [高],
+   带参数 scene 启动时测试分块并行渲染: scene [形状数] [宽] [高] [线程数],
+   带参数 suite 启动时运行基准场景套件: suite [基准图像目录] [update|check] [PNG 输出目录],
+   带参数 index 启动时测试空间索引: index [形状数] [宽] [高] [查询数],
+   带参数 image 启动时把演示图形写成图像文件: image <文件名.pgm|文件名.png>,
+   否则运行原来的演示 */
+int main(int argc, char** argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+        return run_benchmark(argc > 2 ? atoi(argv[2]) : 200000, argc > 3 ? atoi(argv[3]) : 1920,
+            argc > 4 ? atoi(argv[4]) : 1080);
+    }
+    if (argc > 1 && !strcmp(argv[1], "scene")) {
+        return run_scene(argc > 2 ? atoi(argv[2]) : 200000, argc > 3 ? atoi(argv[3]) : 1920,
+            argc > 4 ? atoi(argv[4]) : 1080, argc > 5 ? atoi(argv[5]) : (int)std::thread::hardware_concurrency());
+    }
+    if (argc > 1 && !strcmp(argv[1], "index")) {
+        return run_index(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 16384,
+            argc > 4 ? atoi(argv[4]) : 16384, argc > 5 ? atoi(argv[5]) : 100000);
+    }
+    if (argc > 1 && !strcmp(argv[1], "suite")) {
+        return run_suite(argc > 2 ? argv[2] : "golden", argc > 3 && !strcmp(argv[3], "update"),
+            argc > 4 ? argv[4] : NULL, 100000, 1920, 1080);
+    }
+
+    Framebuffer fb(24, 12);
     Shape *s1;
     Shape *s2;
     Drawing *dp1, *dp2;
 
-    dp1 = new V1Drawing;
-    s1 = new Rectangle(dp, 1, 1, 2, 2);
+    dp1 = new V1Drawing(fb);
+    s1 = new Rectangle(dp1, 1, 1, 10, 8);
 
-    dp2 = new V2Drawing;
-    s2 = new Circle(dp, 2, 2, 4);
+    dp2 = new V2Drawing(fb);
+    s2 = new Circle(dp2, 16, 6, 5);
 
     s1->draw();
     s2->draw();
+    if (argc > 2 && !strcmp(argv[1], "image")) {
+        std::ofstream out(argv[2], std::ios::binary);
+        if (strstr(argv[2], ".png") ? !fb.write_png(out) : !fb.write_pgm(out)) {
+            std::cout << "Error: cannot write " << argv[2] << ".\n";
+        }
+    } else {
+        fb.print();
+    }
 
     delete s1;
     delete s2;
     delete dp1;
     delete dp2;
-}
\ No newline at end of file
+
+    return 0;
+}